@@ -1,169 +1,226 @@
 #include "defs.hpp"
 
+#if !OBSTRUCTION_SLIDERS
 // Store piece attacks
-uint64_t pawnAttacks[2][64];      // [color][square]
-uint64_t knightAttacks[64];       // [square]
-uint64_t kingAttacks[64];         // [square]
-uint64_t bishopOccMasks[64];      // [square]
-uint64_t bishopAttacks[64][512];  // [square][occupancy variations]
-uint64_t rookOccMasks[64];        // [square]
-uint64_t rookAttacks[64][4096];   // [square][occupancy variations]
-
-// clang-format off
-
-// Total number of square a bishop can go to from a certain square
-const int bishopRelevantBits[64] = {
-	6, 5, 5, 5, 5, 5, 5, 6,
-	5, 5, 5, 5, 5, 5, 5, 5,
-	5, 5, 7, 7, 7, 7, 5, 5,
-	5, 5, 7, 9, 9, 7, 5, 5,
-	5, 5, 7, 9, 9, 7, 5, 5,
-	5, 5, 7, 7, 7, 7, 5, 5,
-	5, 5, 5, 5, 5, 5, 5, 5,
-	6, 5, 5, 5, 5, 5, 5, 6,
-};
-
-// Total number of square a rook can go to from a certain square
-const int rookRelevantBits[64] = {
-	12, 11, 11, 11, 11, 11, 11, 12,
-	11, 10, 10, 10, 10, 10, 10, 11,
-	11, 10, 10, 10, 10, 10, 10, 11,
-	11, 10, 10, 10, 10, 10, 10, 11,
-	11, 10, 10, 10, 10, 10, 10, 11,
-	11, 10, 10, 10, 10, 10, 10, 11,
-	11, 10, 10, 10, 10, 10, 10, 11,
-	12, 11, 11, 11, 11, 11, 11, 12,
-};
-// clang-format on
+Magic bishopMagics[64];           // [square]
+Magic rookMagics[64];             // [square]
+// Attacks of every square and occupancy variation; each square only takes as many entries as it
+// has variations (bishops first, rooks after them)
+uint64_t sliderAttacks[BISHOP_TABLE_SIZE + ROOK_TABLE_SIZE];
+#endif
 
 /* Initializes attack tables for all pieces */
 void initAttacks()
 {
-	initLeapers();
+	// The leaper tables are built at compile time. The slider tables stay runtime-built, their
+	// layout depends on the backend picked from the CPU and filling them takes about 2 ms.
+	sliderBackend = detectSliderBackend();
+	useAvx2Fills = avx2Supported();
+#if !OBSTRUCTION_SLIDERS
 	initSliding(BISHOP);
 	initSliding(ROOK);
+#endif
 }
 
-/* Initializes attack tables for leaper pieces
-   King, Knight, Pawn
-*/
-void initLeapers()
-{
-	for (int sq = 0; sq < 64; sq++) {
-		genPawnAttacks(WHITE, sq);
-		genPawnAttacks(BLACK, sq);
-		genKnightAttacks(sq);
-		genKingAttacks(sq);
-	}
-}
-
+#if !OBSTRUCTION_SLIDERS
 /* Initializes attack tables for sliding pieces
    Queen, Bishop, Rook
 */
 void initSliding(const PieceTypes piece)
 {
+	Magic* magics = (piece == BISHOP) ? bishopMagics : rookMagics;
+	uint64_t* attacks = (piece == BISHOP) ? sliderAttacks : sliderAttacks + BISHOP_TABLE_SIZE;
+
 	for (int sq = 0; sq < 64; sq++) {
+		Magic& m = magics[sq];
 		// Generate all possible variations which can obstruct the path of the
 		// bishop or rook
-		bishopOccMasks[sq] = genBishopOccupancy(sq);
-		rookOccMasks[sq] = genRookOccupancy(sq);
-
-		uint64_t currentMask =
-			(piece == BISHOP) ? bishopOccMasks[sq] : rookOccMasks[sq];
-		int bitCount = countBits(currentMask);
-		for (int count = 0; count < (1 << bitCount); count++) {
-			// Generate a 'blocking' variation based on the current 'blocking' mask
-			uint64_t occupancy = setOccupancy(count, bitCount, currentMask);
-			int magicInd;
-			// Generate a magic index that can be used to store the attack's sliding
-			// pieces
-			if (piece == BISHOP) {
-				magicInd = (int)((occupancy * BISHOP_MAGICS[sq]) >> (64 - bitCount));
-				bishopAttacks[sq][magicInd] = genBishopAttack(sq, occupancy);
-			}
-			else {
-				magicInd = (int)((occupancy * ROOK_MAGICS[sq]) >> (64 - bitCount));
-				rookAttacks[sq][magicInd] = genRookAttack(sq, occupancy);
-			}
+		m.mask = (piece == BISHOP) ? genBishopOccupancy(sq) : genRookOccupancy(sq);
+		m.magic = (piece == BISHOP) ? BISHOP_MAGICS[sq] : ROOK_MAGICS[sq];
+		// PEXT needs an entry for every variation, a magic may need fewer (see magic_consts.hpp)
+		int indexBits = countBits(m.mask);
+		if (sliderBackend == SLIDERS_MAGIC) {
+			int magicBits = (piece == BISHOP) ? BISHOP_MAGIC_BITS[sq] : ROOK_MAGIC_BITS[sq];
+			_MY_ASSERT(magicBits <= indexBits, "Magic uses more index bits than there are variations");
+			indexBits = magicBits;
 		}
+		m.shift = 64 - indexBits;
+		// This square's attacks start where the previous square's end
+		m.attacks = attacks;
+		attacks += 1ULL << indexBits;
+
+		// Walk through every 'blocking' variation of the mask, each subset of it follows from
+		// the previous one (Carry-Rippler)
+		uint64_t occupancy = 0ULL;
+		do {
+			// Store the attack at the index the current slider backend looks it up with
+			m.attacks[sliderIndex(m, occupancy)] = (piece == BISHOP)
+				? genBishopAttack(sq, occupancy)
+				: genRookAttack(sq, occupancy);
+			occupancy = (occupancy - m.mask) & m.mask;
+		} while (occupancy);
 	}
 }
+#endif
 
-void genPawnAttacks(const Color side, const int sq)
+static constexpr uint64_t genPawnAttacks(const Color side, const int sq)
 {
+	uint64_t output = 0ULL;
+
 	/* Since the board is set up where a8 is 0 and h1 is 63,
 	   the white pieces attack towards 0 while the black pieces
 	   attack towards 63.
 	*/
 	if (side == Color::WHITE) {
 		if (ROW(sq) > 0 && COL(sq) > 0)
-			setBit(pawnAttacks[WHITE][sq], sq + SW);
+			setBit(output, sq + SW);
 		if (ROW(sq) > 0 && COL(sq) < 7)
-			setBit(pawnAttacks[WHITE][sq], sq + SE);
+			setBit(output, sq + SE);
 	}
 	else {
 		if (ROW(sq) < 7 && COL(sq) > 0)
-			setBit(pawnAttacks[BLACK][sq], sq + NW);
+			setBit(output, sq + NW);
 		if (ROW(sq) < 7 && COL(sq) < 7)
-			setBit(pawnAttacks[BLACK][sq], sq + NE);
+			setBit(output, sq + NE);
 	}
+	return output;
 }
 
-void genKnightAttacks(const int sq)
+static constexpr uint64_t genKnightAttacks(const int sq)
 {
+	uint64_t output = 0ULL;
+
 	/* Knight attacks are generated regardless of the
 	   side to move because knights can go in all directions.
 	   Both sides use this attack table for knights.
 	*/
 	if (ROW(sq) <= 5 && COL(sq) >= 1)
-		setBit(knightAttacks[sq], sq + NW_N);
+		setBit(output, sq + NW_N);
 
 	if (ROW(sq) <= 6 && COL(sq) >= 2)
-		setBit(knightAttacks[sq], sq + NW_W);
+		setBit(output, sq + NW_W);
 
 	if (ROW(sq) <= 6 && COL(sq) <= 5)
-		setBit(knightAttacks[sq], sq + NE_E);
+		setBit(output, sq + NE_E);
 
 	if (ROW(sq) <= 5 && COL(sq) <= 6)
-		setBit(knightAttacks[sq], sq + NE_N);
+		setBit(output, sq + NE_N);
 
 	if (ROW(sq) >= 2 && COL(sq) <= 6)
-		setBit(knightAttacks[sq], sq + SE_S);
+		setBit(output, sq + SE_S);
 
 	if (ROW(sq) >= 1 && COL(sq) <= 5)
-		setBit(knightAttacks[sq], sq + SE_E);
+		setBit(output, sq + SE_E);
 
 	if (ROW(sq) >= 1 && COL(sq) >= 2)
-		setBit(knightAttacks[sq], sq + SW_W);
+		setBit(output, sq + SW_W);
 
 	if (ROW(sq) >= 2 && COL(sq) >= 1)
-		setBit(knightAttacks[sq], sq + SW_S);
+		setBit(output, sq + SW_S);
+
+	return output;
 }
 
-void genKingAttacks(const int sq)
+static constexpr uint64_t genKingAttacks(const int sq)
 {
+	uint64_t output = 0ULL;
+
 	/* king attacks are generated regardless of the
 	   side to move because kings can go in all directions.
 	   Both sides use this attack table for kings.
 	*/
 	if (ROW(sq) > 0)
-		setBit(kingAttacks[sq], sq + SOUTH);
+		setBit(output, sq + SOUTH);
 	if (ROW(sq) < 7)
-		setBit(kingAttacks[sq], sq + NORTH);
+		setBit(output, sq + NORTH);
 	if (COL(sq) > 0)
-		setBit(kingAttacks[sq], sq + WEST);
+		setBit(output, sq + WEST);
 	if (COL(sq) < 7)
-		setBit(kingAttacks[sq], sq + EAST);
+		setBit(output, sq + EAST);
 	if (ROW(sq) > 0 && COL(sq) > 0)
-		setBit(kingAttacks[sq], sq + SW);
+		setBit(output, sq + SW);
 	if (ROW(sq) > 0 && COL(sq) < 7)
-		setBit(kingAttacks[sq], sq + SE);
+		setBit(output, sq + SE);
 	if (ROW(sq) < 7 && COL(sq) > 0)
-		setBit(kingAttacks[sq], sq + NW);
+		setBit(output, sq + NW);
 	if (ROW(sq) < 7 && COL(sq) < 7)
-		setBit(kingAttacks[sq], sq + NE);
+		setBit(output, sq + NE);
+	return output;
+}
+
+static constexpr std::array<std::array<uint64_t, 64>, 2> initPawnAttacks()
+{
+	std::array<std::array<uint64_t, 64>, 2> table{};
+	for (int sq = 0; sq < 64; sq++) {
+		table[WHITE][sq] = genPawnAttacks(WHITE, sq);
+		table[BLACK][sq] = genPawnAttacks(BLACK, sq);
+	}
+	return table;
+}
+
+static constexpr std::array<uint64_t, 64> initKnightAttacks()
+{
+	std::array<uint64_t, 64> table{};
+	for (int sq = 0; sq < 64; sq++)
+		table[sq] = genKnightAttacks(sq);
+	return table;
+}
+
+static constexpr std::array<uint64_t, 64> initKingAttacks()
+{
+	std::array<uint64_t, 64> table{};
+	for (int sq = 0; sq < 64; sq++)
+		table[sq] = genKingAttacks(sq);
+	return table;
+}
+
+// Leaper attacks don't depend on the occupancy, so they are computed at compile time
+constexpr std::array<std::array<uint64_t, 64>, 2> pawnAttacks = initPawnAttacks(); // [color][square]
+constexpr std::array<uint64_t, 64> knightAttacks = initKnightAttacks();             // [square]
+constexpr std::array<uint64_t, 64> kingAttacks = initKingAttacks();                 // [square]
+
+/* Walks from sq1 towards sq2 and returns the squares strictly between them, or the whole rank,
+   file or diagonal through both when 'fullLine' is set. Squares that don't share a rank, file or
+   diagonal have no line between them.
+*/
+static uint64_t genLine(const int sq1, const int sq2, const bool fullLine)
+{
+	uint64_t output = 0ULL;
+	int dr = ROW(sq2) - ROW(sq1), df = COL(sq2) - COL(sq1);
+	if (sq1 == sq2 || (dr != 0 && df != 0 && dr != df && dr != -df))
+		return output;
+	dr = (dr > 0) - (dr < 0);
+	df = (df > 0) - (df < 0);
+
+	if (!fullLine) {
+		for (int r = ROW(sq1) + dr, f = COL(sq1) + df; SQ(r, f) != sq2; r += dr, f += df)
+			setBit(output, SQ(r, f));
+		return output;
+	}
+	// Both directions from sq1 up to the board's edges
+	for (int r = ROW(sq1), f = COL(sq1); r >= 0 && r <= 7 && f >= 0 && f <= 7; r += dr, f += df)
+		setBit(output, SQ(r, f));
+	for (int r = ROW(sq1), f = COL(sq1); r >= 0 && r <= 7 && f >= 0 && f <= 7; r -= dr, f -= df)
+		setBit(output, SQ(r, f));
+	return output;
+}
+
+/* Built during static initialization, which takes microseconds. As constexpr tables they would
+   need more evaluation steps than GCC and Clang allow by default.
+*/
+static std::array<std::array<uint64_t, 64>, 64> initLines(const bool fullLine)
+{
+	std::array<std::array<uint64_t, 64>, 64> table{};
+	for (int sq1 = 0; sq1 < 64; sq1++)
+		for (int sq2 = 0; sq2 < 64; sq2++)
+			table[sq1][sq2] = genLine(sq1, sq2, fullLine);
+	return table;
 }
 
+// Lines between two squares, used for checks, pins and castling paths [square][square]
+const std::array<std::array<uint64_t, 64>, 64> squaresBetween = initLines(false);
+const std::array<std::array<uint64_t, 64>, 64> lineThrough = initLines(true);
+
 /* Generates all the maximum occupancy on a bishop's path on its given square */
 uint64_t genBishopOccupancy(const int sq)
 {
@@ -281,17 +338,3 @@ uint64_t genRookAttack(const int sq, const uint64_t blockerBoard)
 
 	return output;
 }
-
-/* Generates a variation of 'blocking' pieces given an index, relevant bits, and
-   occupancy mask */
-uint64_t setOccupancy(const int index, const int relevantBits, uint64_t occMask)
-{
-	uint64_t occupancy = 0ULL;
-	for (int count = 0; count < relevantBits; count++) {
-		int ls1bIndex = lsbIndex(occMask);
-		popBit(occMask, ls1bIndex);
-		if ((index & (1 << count)) > 0)
-			setBit(occupancy, ls1bIndex);
-	}
-	return occupancy;
-}
\ No newline at end of file
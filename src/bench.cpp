@@ -0,0 +1,175 @@
+#include "defs.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+// Perft depth for each of FEN_POSITIONS[1..7]
+static const int BENCH_PERFT_DEPTHS[7] = {5, 4, 5, 4, 4, 4, 4};
+
+static void printBenchLine(const std::string& name, const uint64_t nodes, const long long time)
+{
+    std::cout << "  " << name << nodes << " nodes, " << time << " ms, "
+              << (time ? nodes / time : nodes) << " knps\n";
+}
+
+// Obstruction difference replaces the attack tables at compile time, so a build benches either
+// that or the table backends
+#if OBSTRUCTION_SLIDERS
+static const int FIRST_BACKEND = SLIDERS_OBSTRUCTION, LAST_BACKEND = SLIDERS_OBSTRUCTION;
+#else
+static const int FIRST_BACKEND = SLIDERS_MAGIC, LAST_BACKEND = SLIDERS_PEXT;
+#endif
+
+// Prints the backend's name and switches to it, false if the CPU doesn't support it
+static bool useBenchBackend(const int backend)
+{
+    std::cout << "Sliders: " << SLIDER_BACKEND_STR[backend] << "\n";
+    if (backend == SLIDERS_PEXT && !pextSupported()) {
+        std::cout << "  not supported by this CPU\n";
+        return false;
+    }
+    setSliderBackend((SliderBackend)backend);
+    return true;
+}
+
+// Single threaded perft and fixed depth search over the built in positions, repeated for every
+// slider backend the CPU supports
+void runBench(const int depth)
+{
+    SliderBackend startBackend = sliderBackend;
+    for (int backend = FIRST_BACKEND; backend <= LAST_BACKEND; backend++) {
+        if (!useBenchBackend(backend))
+            continue;
+
+        Board board;
+        uint64_t nodes = 0;
+        long long start = getCurrTime();
+        for (int i = 1; i < 8; i++) {
+            board.parseFen(FEN_POSITIONS[i]);
+            driver(board, BENCH_PERFT_DEPTHS[i - 1], nodes, AllMoves);
+        }
+        printBenchLine("perft:  ", nodes, getCurrTime() - start);
+
+        // Clearing also pages the table in, so the first backend doesn't pay for that
+        hashTable.clear(1);
+        nodes = 0;
+        start = getCurrTime();
+        for (int i = 1; i < 8; i++) {
+            board.parseFen(FEN_POSITIONS[i]);
+            SearchInfo info;
+            info.searchDepth = depth;
+            SearchTable* sTable = new SearchTable();
+            // Only thread 0 prints search info
+            SearchWorkerData data = {&board, &hashTable, &info, sTable, 1};
+            workerSearchPos(&data);
+            nodes += sTable->nodes;
+            delete sTable;
+        }
+        printBenchLine("search: ", nodes, getCurrTime() - start);
+    }
+    setSliderBackend(startBackend);
+}
+
+static std::atomic<uint64_t> threadBenchNodes;
+
+// The same perft over the built in positions as the single threaded bench
+static int threadBenchWorker(void* arg)
+{
+    (void)arg;
+    Board board;
+    uint64_t nodes = 0;
+    for (int i = 1; i < 8; i++) {
+        board.parseFen(FEN_POSITIONS[i]);
+        driver(board, BENCH_PERFT_DEPTHS[i - 1], nodes, AllMoves);
+    }
+    threadBenchNodes += nodes;
+    return 0;
+}
+
+// Runs the perft on 1, 8 and 32 threads at once, each on its own boards, to see how the slider
+// backends hold up when many cores share the caches
+void runThreadBench()
+{
+    const int THREAD_COUNTS[3] = {1, 8, 32};
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << "\n";
+
+    SliderBackend startBackend = sliderBackend;
+    for (int backend = FIRST_BACKEND; backend <= LAST_BACKEND; backend++) {
+        if (!useBenchBackend(backend))
+            continue;
+        for (const int threadCount : THREAD_COUNTS) {
+            thrd_t threads[32];
+            threadBenchNodes = 0;
+            long long start = getCurrTime();
+            for (int i = 0; i < threadCount; i++)
+                thrd_create(&threads[i], threadBenchWorker, nullptr);
+            for (int i = 0; i < threadCount; i++)
+                thrd_join(threads[i], nullptr);
+            printBenchLine(std::to_string(threadCount) + " threads: ", threadBenchNodes,
+                           getCurrTime() - start);
+        }
+    }
+    setSliderBackend(startBackend);
+}
+
+// Union of the sliders' attacks of one side, one table lookup per piece
+static uint64_t lookupSliderAttacks(const Board& board, const Color side)
+{
+    int offset = side == WHITE ? 0 : 6;
+    uint64_t attacks = 0ULL;
+    uint64_t rooks = board.pieces[wR + offset] | board.pieces[wQ + offset];
+    uint64_t bishops = board.pieces[wB + offset] | board.pieces[wQ + offset];
+    while (rooks)
+        attacks |= getRookAttack(popLsb(rooks), board.units[BOTH]);
+    while (bishops)
+        attacks |= getBishopAttack(popLsb(bishops), board.units[BOTH]);
+    return attacks;
+}
+
+static uint64_t filledSliderAttacks(const Board& board, const Color side)
+{
+    int offset = side == WHITE ? 0 : 6;
+    return fillSliderAttacks(board.pieces[wR + offset] | board.pieces[wQ + offset],
+                             board.pieces[wB + offset] | board.pieces[wQ + offset],
+                             board.units[BOTH]);
+}
+
+// Time per attack map of all the sliders of one side, over the built in positions
+template <typename F> static void timeSliderAttacks(const std::string& name, F sliderAttacks)
+{
+    const int ITERATIONS = 1'000'000;
+    Board boards[7];
+    for (int i = 0; i < 7; i++)
+        boards[i].parseFen(FEN_POSITIONS[i + 1]);
+
+    uint64_t checksum = 0ULL;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++)
+        for (int j = 0; j < 7; j++)
+            checksum += sliderAttacks(boards[j], (Color)((i + j) & 1));
+    auto time = std::chrono::steady_clock::now() - start;
+
+    double ns = std::chrono::duration<double, std::nano>(time).count() / (ITERATIONS * 7.0);
+    // The checksum keeps the compiler from dropping the loop
+    std::cout << "  " << std::left << std::setw(16) << name << std::fixed << std::setprecision(1) << ns << " ns per map (checksum "
+              << (checksum & 0xFFFF) << ")\n";
+}
+
+// Compares sliding attack maps built from the current backend's lookups with Kogge-Stone fills
+void runFillBench()
+{
+    bool startAvx2 = useAvx2Fills;
+    std::cout << "Attack maps of all the sliders of one side\n";
+    timeSliderAttacks(SLIDER_BACKEND_STR[sliderBackend] + " lookups:", lookupSliderAttacks);
+
+    useAvx2Fills = false;
+    timeSliderAttacks("scalar fill:", filledSliderAttacks);
+    if (avx2Supported()) {
+        useAvx2Fills = true;
+        timeSliderAttacks("AVX2 fill:", filledSliderAttacks);
+    } else
+        std::cout << "  AVX2 fill:      not supported by this CPU\n";
+    useAvx2Fills = startAvx2;
+}
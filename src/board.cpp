@@ -1,4 +1,5 @@
 #include "defs.hpp"
+#include <algorithm>
 
 const std::string PIECE_STR = "PNBRQKpnbrqk ";
 
@@ -14,6 +15,9 @@ const uint8_t CASTLING_RIGHTS[64] = {
     15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
     15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 13, 15, 15, 15, 12, 15, 15, 14 };
 
+// Piece values used by the static exchange evaluation [piece type]
+const int SEE_VALUES[6] = {100, 300, 300, 500, 900, 20'000};
+
 const std::string FEN_POSITIONS[8] = {
     "8/8/8/8/8/8/8/8 w - - 0 1",
     "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
@@ -29,7 +33,7 @@ Board::Board()
 {
     memset(pieces, 0ULL, sizeof(pieces));
     memset(units, 0ULL, sizeof(units));
-    memset(repetitionTable, 0ULL, sizeof(repetitionTable));
+    memset(mailbox, EMPTY << 4 | EMPTY, sizeof(mailbox));
 
     side = WHITE;
     castling = 0;
@@ -38,17 +42,9 @@ Board::Board()
     fullMoves = 1;
     key = 0;
     lock = 0;
-    repetitionIndex = 0;
 }
 
-Piece Board::findPiece(const Sq sq) const
-{
-    for (int i = 0; i < 12; i++) {
-        if (getBit(pieces[i], sq))
-            return (Piece)i;
-    }
-    return EMPTY;
-}
+Piece Board::findPiece(const Sq sq) const { return pieceOn(sq); }
 
 void Board::updateUnits()
 {
@@ -93,36 +89,135 @@ const std::string Board::formatCastling() const
     return castling_str;
 }
 
-bool Board::sqAttacked(Sq sq, Color color) const
+bool Board::sqAttacked(Sq sq, Color color) const { return sqAttacked(sq, color, units[BOTH]); }
+
+bool Board::sqAttacked(Sq sq, Color color, uint64_t occupancy) const
 {
-    // Attacked by white pawns
-    if ((color == WHITE) &&
-        (pawnAttacks[BLACK][sq] & pieces[wP]))
-        return true;
-    // Attacked by black pawns
-    if ((color == BLACK) &&
-        (pawnAttacks[WHITE][sq] & pieces[bP]))
+    return color == WHITE ? sqAttacked<WHITE>(sq, occupancy) : sqAttacked<BLACK>(sq, occupancy);
+}
+
+template <Color By> bool Board::sqAttacked(Sq sq, uint64_t occupancy) const
+{
+    constexpr int offset = By == WHITE ? 0 : 6;
+
+    // Attacked by pawns
+    if ((pawnAttacks[By == WHITE ? BLACK : WHITE][sq] & pieces[wP + offset]) != 0)
         return true;
     // Attacked by knights
-    if ((knightAttacks[sq] & pieces[color == WHITE ? wN : bN]) != 0)
-        return true;
-    // Attacked by bishops
-    if ((getBishopAttack(sq, units[BOTH]) & pieces[color == WHITE ? wB : bB]) != 0)
+    if ((knightAttacks[sq] & pieces[wN + offset]) != 0)
         return true;
-    // Attacked by rooks
-    if ((getRookAttack(sq, units[BOTH]) & pieces[color == WHITE ? wR : bR]) != 0)
+    // Attacked by bishops or queens
+    if ((getBishopAttack(sq, occupancy) & (pieces[wB + offset] | pieces[wQ + offset])) != 0)
         return true;
-    // Attacked by queens
-    if ((getQueenAttack(sq, units[BOTH]) & pieces[color == WHITE ? wQ : bQ]) != 0)
+    // Attacked by rooks or queens
+    if ((getRookAttack(sq, occupancy) & (pieces[wR + offset] | pieces[wQ + offset])) != 0)
         return true;
     // Attacked by kings
-    if ((kingAttacks[sq] & pieces[color == WHITE ? wK : bK]) != 0)
+    if ((kingAttacks[sq] & pieces[wK + offset]) != 0)
         return true;
 
     // If all of the above cases fail, return false
     return false;
 }
 
+template bool Board::sqAttacked<WHITE>(Sq sq, uint64_t occupancy) const;
+template bool Board::sqAttacked<BLACK>(Sq sq, uint64_t occupancy) const;
+
+// Every square attacked by side 'By', with its sliders stopped by 'occupancy'
+template <Color By> uint64_t Board::attackMap(uint64_t occupancy) const
+{
+    constexpr int offset = By == WHITE ? 0 : 6;
+
+    // White pawns capture towards the 8th rank (lower squares), black pawns towards the 1st
+    uint64_t pawns = pieces[wP + offset];
+    uint64_t attacks = By == WHITE ? ((pawns >> 9) & NOT_H_FILE) | ((pawns >> 7) & NOT_A_FILE)
+                                   : ((pawns << 7) & NOT_H_FILE) | ((pawns << 9) & NOT_A_FILE);
+    uint64_t knights = pieces[wN + offset];
+    while (knights)
+        attacks |= knightAttacks[popLsb(knights)];
+    if (pieces[wK + offset])
+        attacks |= kingAttacks[lsbIndex(pieces[wK + offset])];
+
+    // All sliders at once
+    return attacks | fillSliderAttacks(pieces[wR + offset] | pieces[wQ + offset],
+                                       pieces[wB + offset] | pieces[wQ + offset], occupancy);
+}
+
+template uint64_t Board::attackMap<WHITE>(uint64_t occupancy) const;
+template uint64_t Board::attackMap<BLACK>(uint64_t occupancy) const;
+
+// Pieces of both colors that attack 'sq', with sliders looking through 'occupancy'
+uint64_t Board::attackersTo(Sq sq, uint64_t occupancy) const
+{
+    return (pawnAttacks[BLACK][sq] & pieces[wP]) | (pawnAttacks[WHITE][sq] & pieces[bP]) |
+           (knightAttacks[sq] & (pieces[wN] | pieces[bN])) |
+           (getBishopAttack(sq, occupancy) & (pieces[wB] | pieces[bB] | pieces[wQ] | pieces[bQ])) |
+           (getRookAttack(sq, occupancy) & (pieces[wR] | pieces[bR] | pieces[wQ] | pieces[bQ])) |
+           (kingAttacks[sq] & (pieces[wK] | pieces[bK]));
+}
+
+/*
+        Static Exchange Evaluation (SEE)
+        Plays out all captures on the target square of 'move', always recapturing with the least
+        valuable attacker, and returns the material balance for the side making the move. Either
+        side may stop capturing when continuing would lose material.
+*/
+int Board::see(const int move) const
+{
+    int target = getTarget(move);
+    int gain[32], depth = 0;
+    uint64_t occupancy = units[BOTH];
+    uint64_t bishopsQueens = pieces[wB] | pieces[bB] | pieces[wQ] | pieces[bQ];
+    uint64_t rooksQueens = pieces[wR] | pieces[bR] | pieces[wQ] | pieces[bQ];
+
+    if (isEnpassant(move)) {
+        gain[0] = SEE_VALUES[PAWN];
+        popBit(occupancy, target + (side == WHITE ? NORTH : SOUTH));
+    } else
+        gain[0] = pieceOn(target) == EMPTY ? 0 : SEE_VALUES[COLORLESS(pieceOn(target))];
+
+    int attacker = COLORLESS(getPiece(move));
+    uint64_t fromSet = 1ULL << getSource(move);
+    uint64_t attackers = attackersTo((Sq)target, occupancy);
+    Color color = side;
+
+    do {
+        depth++;
+        // Score if the piece on 'target' gets recaptured
+        gain[depth] = SEE_VALUES[attacker] - gain[depth - 1];
+        // Neither side can improve by continuing the exchange
+        if (std::max(-gain[depth - 1], gain[depth]) < 0)
+            break;
+
+        // Remove the attacker and add the sliders that were behind it. Those can only be on the
+        // line from the target through the attacker, and knights or kings never uncover one.
+        occupancy ^= fromSet;
+        if (attacker != KNIGHT && attacker != KING) {
+            int fromSq = lsbIndex(fromSet);
+            if (ROW(fromSq) == ROW(target) || COL(fromSq) == COL(target))
+                attackers |= getRookAttack(target, occupancy) & rooksQueens;
+            else
+                attackers |= getBishopAttack(target, occupancy) & bishopsQueens;
+        }
+        attackers &= occupancy;
+
+        // Next attacker is the least valuable piece of the other side
+        color = (Color)(color ^ 1);
+        fromSet = 0ULL;
+        for (attacker = PAWN; attacker <= KING; attacker++) {
+            uint64_t bitboard = attackers & pieces[attacker + (color == WHITE ? 0 : 6)];
+            if (bitboard) {
+                fromSet = bitboard & (0ULL - bitboard);
+                break;
+            }
+        }
+    } while (fromSet);
+
+    while (--depth)
+        gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+    return gain[0];
+}
+
 bool Board::inCheck() const
 {
     uint8_t piece = side == WHITE ? bK : wK;
@@ -151,6 +246,7 @@ void Board::parseFen(const std::string& fen)
                 size_t piece;
                 if ((piece = PIECE_STR.find(fen[currIndex])) != EMPTY) {
                     setBit(pieces[piece], SQ(rank, file));
+                    setPieceOn(SQ(rank, file), piece);
                 }
                 currIndex++;
             }
@@ -92,8 +92,7 @@ uint64_t genPolyKey(const Board& board)
     for (int p = wP; p <= bK; p++) {
         bbCopy = board.pieces[p];
         while (bbCopy) {
-            sq = lsbIndex(bbCopy);
-            popBit(bbCopy, sq);
+            sq = popLsb(bbCopy);
 
             sq = FLIP(sq);
             polyIndex = (64 * POLY_PIECE[p]) + (8 * ROW(sq) + COL(sq));
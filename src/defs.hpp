@@ -2,13 +2,29 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <iostream>
 #include <string>
 #include "tinycthread.h"
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
 
 #define VERSION "1.1"
 
+// Set to 1 to take moves back by restoring a full copy of the board (copy-make)
+// instead of unmaking them from a small undo record
+#ifndef COPY_MAKE
+#define COPY_MAKE 0
+#endif
+
+// Set to 1 to compute sliding attacks by obstruction difference from a few KB of line masks
+// instead of looking them up in the magic/PEXT attack table
+#ifndef OBSTRUCTION_SLIDERS
+#define OBSTRUCTION_SLIDERS 0
+#endif
+
 #define _MY_ASSERT(condition, message) custom_assert(condition, message, __LINE__, __FILE__)
 inline void custom_assert(bool cond, std::string msg, int line, std::string filename)
 {
@@ -43,6 +59,8 @@ enum Sq {
 #define setBit(bitboard, square) ((bitboard) |= (1ULL << (square)))
 #define getBit(bitboard, square) (((bitboard) & (1ULL << (square))) ? 1 : 0)
 #define popBit(bitboard, square) ((bitboard) &= ~(1ULL << (square)))
+#define NOT_A_FILE 0xFEFEFEFEFEFEFEFEULL
+#define NOT_H_FILE 0x7F7F7F7F7F7F7F7FULL
 
 /* Pieces */
 enum Piece { wP, wN, wB, wR, wQ, wK, bP, bN, bB, bR, bQ, bK, EMPTY };
@@ -51,10 +69,16 @@ enum Color { WHITE, BLACK, BOTH };
 
 enum CastlingRights { c_wk, c_wq, c_bk, c_bq };
 
-enum MoveType { AllMoves, OnlyCaptures };
+enum MoveType { AllMoves, OnlyCaptures, OnlyQuiets };
+
+// Special move types of a packed (16-bit) move
+enum PackedMoveFlag { PM_NORMAL, PM_PROMOTION, PM_ENPASSANT, PM_CASTLING };
 
 enum TTFlag { F_EXACT, F_ALPHA, F_BETA };
 
+// How sliding piece attacks are looked up
+enum SliderBackend { SLIDERS_MAGIC, SLIDERS_PEXT, SLIDERS_OBSTRUCTION };
+
 /* Direction offsets */
 enum Direction {
     NORTH = 8,
@@ -76,6 +100,16 @@ enum Direction {
 };
 
 // STRUCTURES
+// attack.cpp
+// Everything needed to look up a slider's attacks from one square, kept within one cache line
+struct alignas(32) Magic
+{
+    uint64_t mask;     // Squares whose occupancy changes the attacks (board edges excluded)
+    uint64_t magic;
+    uint64_t* attacks; // This square's part of sliderAttacks
+    int shift;         // 64 - number of relevant bits
+};
+
 // board.cpp
 struct Board
 {
@@ -84,16 +118,32 @@ struct Board
     void parseFen(const std::string& fen_str);
 
     Piece findPiece(const Sq sq) const;
+    // The mailbox packs two squares into each byte, the even square in the low nibble
+    Piece pieceOn(const int sq) const
+    {
+        return (Piece)((mailbox[sq >> 1] >> ((sq & 1) * 4)) & 0xF);
+    }
+    void setPieceOn(const int sq, const int piece)
+    {
+        const int shift = (sq & 1) * 4;
+        mailbox[sq >> 1] = (uint8_t)((mailbox[sq >> 1] & ~(0xF << shift)) | (piece << shift));
+    }
     void updateUnits();
     void changeSide();
     void display() const;
     bool sqAttacked(Sq sq, Color color) const;
+    bool sqAttacked(Sq sq, Color color, uint64_t occupancy) const;
+    template <Color By> bool sqAttacked(Sq sq, uint64_t occupancy) const;
+    template <Color By> uint64_t attackMap(uint64_t occupancy) const;
     bool inCheck() const;
+    uint64_t attackersTo(Sq sq, uint64_t occupancy) const;
+    int see(const int move) const;
 
   public:
     // Piece positions
     uint64_t pieces[12];
     uint64_t units[3];
+    uint8_t mailbox[32]; // [square / 2] -> two pieces (EMPTY if no piece), see pieceOn
 
     // State of the board
     Color side;
@@ -106,9 +156,6 @@ struct Board
     uint64_t key;
     uint64_t lock;
 
-    uint64_t repetitionTable[1000];
-    int32_t repetitionIndex;
-
   private:
     const std::string formatCastling() const;
 };
@@ -125,16 +172,50 @@ struct PolyEntry
 };
 
 // move.cpp
+// A move together with its move ordering score
+struct ExtMove
+{
+    int move;
+    int score;
+
+    operator int() const { return move; }
+    ExtMove& operator=(const int m) { move = m; return *this; }
+};
+
+// The moves aren't initialized, only the first 'count' of them are ever read
 struct MoveList
 {
-    int list[256];
+    ExtMove list[256];
     short count = 0;
-    MoveList();
     void add(const int move);
     int search(const int source, const int target, const int promoted = EMPTY) const;
     void print() const;
 };
 
+// Check and pin information of the side to move
+struct CheckInfo
+{
+    int kingSq;
+    uint64_t checkers;  // Enemy pieces attacking the king
+    uint64_t checkMask; // Squares that capture the checker or block the check
+    uint64_t pinned;    // Own pieces that can't leave the line between the king and a slider
+};
+
+// Information needed to take back a move
+struct Undo
+{
+#if COPY_MAKE
+    Board board;
+#else
+    int captured;
+    uint8_t castling;
+    Sq enpassant;
+    uint32_t halfMoves;
+    uint64_t key;
+    uint64_t lock;
+#endif
+};
+
 // tt.cpp
 struct TT
 {
@@ -146,13 +227,19 @@ struct TT
     int score;   // score (alpha/beta/PV)
 	*/
 
-    int age;
-    uint64_t smpKey;
-    uint64_t smpData;
+    uint64_t smpKey;  // Position key ^ smpData, so a torn write never matches
+    uint64_t smpData; // Score, depth, flag, age and best move (see tt.cpp)
 
     TT();
 };
 
+// The entries of a bucket share one cache line, so a probe costs at most one cache miss
+#define TT_BUCKET_SIZE 4
+struct alignas(64) TTBucket
+{
+    TT entries[TT_BUCKET_SIZE];
+};
+
 #define MAX_PLY 64
 #define MAX_THREADS 4
 
@@ -182,32 +269,75 @@ struct SearchTable
 	uint64_t nodes;
 
 	// Quiet moves that caused a beta-cutoff
-	int killerMoves[2][MAX_PLY]; // [id][ply]
+	uint16_t killerMoves[2][MAX_PLY]; // [id][ply] (packed moves)
 	// Quiet moves that updated the alpha value
 	int historyMoves[12][64];      // [piece][square]
-	int pvLength[MAX_PLY];         // [ply]
-	int pvTable[MAX_PLY][MAX_PLY]; // [ply][ply]
+	int pvLength[MAX_PLY];              // [ply]
+	uint16_t pvTable[MAX_PLY][MAX_PLY]; // [ply][ply] (packed moves)
+
+	// PV flag
+	bool followPV;
 
-	// PV flags
-	bool followPV, scorePV;
+	// Keys of the positions played so far (game moves + search path)
+	uint64_t repetitionTable[1000];
+	int32_t repetitionIndex = 0;
 };
 
 struct HashTable
 {
-    TT* table;
-    int entryCount;
-    int currentAge;
+    void* memory;    // Allocation that the 2 MB aligned table lies in
+    size_t memorySize;
+    TTBucket* table;
+    uint64_t bucketCount;
+    uint64_t entryCount;
+    int currentAge;  // Advanced once per search
 
     // Stats
-    int newWrite;
-    int overWrite;
+    uint64_t newWrite;
+    uint64_t overWrite;
 
     HashTable();
-    void init(int MB);
+    void init(uint64_t MB);
     void deinit();
-    int read(Board& board, const SearchTable& sTable, int alpha, int beta, int depth);
-    void store(Board& board, const SearchTable& sTable, int score, int depth, TTFlag flag);
-    void clear();
+    int read(Board& board, const SearchTable& sTable, int alpha, int beta, int depth,
+             int& hashMove);
+    void store(Board& board, const SearchTable& sTable, int score, int depth, TTFlag flag,
+               const int move);
+    void clear(const int threadCount);
+    TTBucket* bucketOf(const uint64_t key) const;
+    void prefetch(const uint64_t key) const;
+};
+
+// movepicker.cpp
+enum PickerStage {
+    PICK_PV,
+    PICK_GEN_CAPTURES,
+    PICK_GOOD_CAPTURES,
+    PICK_KILLERS,
+    PICK_GEN_QUIETS,
+    PICK_QUIETS,
+    PICK_BAD_CAPTURES,
+    PICK_DONE
+};
+
+// Hands out the moves of a position one stage at a time, so that nothing is generated for the
+// stages that are never reached after a beta-cutoff
+struct MovePicker
+{
+    MovePicker(const Board& board, const CheckInfo& info, const SearchTable& sTable,
+               const int pvMove, MoveType moveType);
+    int next(); // Returns 0 once all moves have been picked
+
+    const Board& board;
+    const CheckInfo& info;
+    const SearchTable& sTable;
+    MoveType moveType;
+    int stage;
+    int pvMove;
+    int killers[2];
+    int current;
+    MoveList moveList;
+    MoveList badCaptures; // Captures that lose material, tried after the quiet moves
 };
 
 // thread.cpp
@@ -228,24 +358,53 @@ struct SearchWorkerData
     int threadID;
 };
 
+// zobrist.cpp
+// XOR shift random number generator, usable at compile time so that tables built from it don't
+// have to be filled at startup (tools/magicgen uses it too)
+struct XorShift
+{
+    uint32_t state = 1804289383;
+
+    constexpr uint32_t random32()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    constexpr uint64_t random64()
+    {
+        uint64_t rand1 = random32() & 0xFFFF;
+        uint64_t rand2 = random32() & 0xFFFF;
+        uint64_t rand3 = random32() & 0xFFFF;
+        uint64_t rand4 = random32() & 0xFFFF;
+        return rand1 | (rand2 << 16) | (rand3 << 32) | (rand4 << 48);
+    }
+};
+
 // GLOBAL VARIABLES
 extern const std::string PIECE_STR;
 extern const std::string STR_COORDS[65];
 
 // attack.cpp
-extern uint64_t pawnAttacks[2][64];      // [color][square]
-extern uint64_t knightAttacks[64];       // [square]
-extern uint64_t kingAttacks[64];         // [square]
-extern uint64_t bishopOccMasks[64];      // [square]
-extern uint64_t bishopAttacks[64][512];  // [square][occupancy variations]
-extern uint64_t rookOccMasks[64];        // [square]
-extern uint64_t rookAttacks[64][4096];   // [square][occupancy variations]
-extern const int bishopRelevantBits[64]; // [square]
-extern const int rookRelevantBits[64];   // [square]
+extern const std::array<std::array<uint64_t, 64>, 2> pawnAttacks; // [color][square]
+extern const std::array<uint64_t, 64> knightAttacks;              // [square]
+extern const std::array<uint64_t, 64> kingAttacks;                // [square]
+// Squares strictly between two squares that share a rank, file or diagonal, 0 otherwise
+extern const std::array<std::array<uint64_t, 64>, 64> squaresBetween; // [square][square]
+// Full rank, file or diagonal through two squares (both included), 0 if they aren't aligned
+extern const std::array<std::array<uint64_t, 64>, 64> lineThrough;    // [square][square]
+#define BISHOP_TABLE_SIZE 5248  // Sum of the bishop's occupancy variations over all squares
+#define ROOK_TABLE_SIZE 102400  // Sum of the rook's occupancy variations over all squares
+extern Magic bishopMagics[64];           // [square]
+extern Magic rookMagics[64];             // [square]
+extern uint64_t sliderAttacks[BISHOP_TABLE_SIZE + ROOK_TABLE_SIZE];
 
 // board.cpp
 extern const std::string FEN_POSITIONS[8];
 extern const uint8_t CASTLING_RIGHTS[64];
+extern const int SEE_VALUES[6];
 
 // book.cpp
 extern PolyEntry* bookEntries;
@@ -254,6 +413,11 @@ extern bool outOfBookMoves;
 // magics.cpp
 extern const uint64_t BISHOP_MAGICS[64];
 extern const uint64_t ROOK_MAGICS[64];
+extern const int BISHOP_MAGIC_BITS[64];
+extern const int ROOK_MAGIC_BITS[64];
+extern SliderBackend sliderBackend;
+extern const std::string SLIDER_BACKEND_STR[3];
+extern bool useAvx2Fills;
 
 // search.cpp
 extern const int INF;
@@ -271,6 +435,7 @@ extern bool threadCreated;
 extern HashTable hashTable;
 extern const int NO_TT_ENTRY;
 #define DEFAULT_TT_SIZE 256
+#define MAX_TT_SIZE 33554432 // 32 TB, in MB
 
 // uci.cpp
 extern SearchInfo sInfo;
@@ -278,30 +443,97 @@ extern SearchInfo sInfo;
 // FUNCTION PROTOTYPES
 // attack.cpp
 void initAttacks();
-void initLeapers();
 void initSliding(const PieceTypes piece);
-void genPawnAttacks(const Color side, const int sq);
-void genKnightAttacks(const int sq);
-void genKingAttacks(const int sq);
 uint64_t genBishopOccupancy(const int sq);
 uint64_t genBishopAttack(const int sq, const uint64_t blockerBoard);
 uint64_t genRookOccupancy(const int sq);
 uint64_t genRookAttack(const int sq, const uint64_t blockerBoard);
-uint64_t setOccupancy(const int index, const int relevantBits, uint64_t attackMask);
 
 // bitboard.cpp
 void printBits(const uint64_t bitboard);
+// Use the CPU's popcount and bitscan instructions where the compiler exposes them
 inline int countBits(uint64_t bitboard)
 {
+#if defined(__GNUC__)
+    return __builtin_popcountll(bitboard);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return (int)__popcnt64(bitboard);
+#else
     int count = 0;
     for (count = 0; bitboard; count++, bitboard &= bitboard - 1)
         ;
     return count;
+#endif
 }
+// Returns 0 for an empty bitboard
 inline int lsbIndex(const uint64_t bitboard)
 {
+#if defined(__GNUC__)
+    return bitboard ? __builtin_ctzll(bitboard) : 0;
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    return _BitScanForward64(&index, bitboard) ? (int)index : 0;
+#else
     return bitboard > 0 ? countBits(bitboard ^ (bitboard - 1)) - 1 : 0;
+#endif
 }
+inline int msbIndex(const uint64_t bitboard)
+{
+#if defined(__GNUC__)
+    return bitboard ? 63 ^ __builtin_clzll(bitboard) : 0;
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    return _BitScanReverse64(&index, bitboard) ? (int)index : 0;
+#else
+    int sq = 0;
+    while (bitboard >>= 1)
+        sq++;
+    return sq;
+#endif
+}
+// Removes the least significant bit from the bitboard and returns its index
+inline int popLsb(uint64_t& bitboard)
+{
+    int sq = lsbIndex(bitboard);
+    bitboard &= bitboard - 1;
+    return sq;
+}
+// High 64 bits of the 128 bit product
+inline uint64_t mulHigh(const uint64_t a, const uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    return (uint64_t)(((unsigned __int128)a * b) >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return __umulh(a, b);
+#else
+    uint64_t aLo = (uint32_t)a, aHi = a >> 32, bLo = (uint32_t)b, bHi = b >> 32;
+    uint64_t mid = aHi * bLo + ((aLo * bLo) >> 32);
+    uint64_t mid2 = aLo * bHi + (uint32_t)mid;
+    return aHi * bHi + (mid >> 32) + (mid2 >> 32);
+#endif
+}
+
+// tt.cpp
+// The key's bucket, key * bucketCount / 2^64 spreads the keys as evenly as a modulo would without
+// dividing, and works for any table size
+inline TTBucket* HashTable::bucketOf(const uint64_t key) const
+{
+    return &table[mulHigh(key, bucketCount)];
+}
+// Starts loading the key's bucket into the cache, so that the probe doesn't wait on memory
+inline void HashTable::prefetch(const uint64_t key) const
+{
+#if defined(__GNUC__)
+    __builtin_prefetch(bucketOf(key));
+#elif defined(_MSC_VER) && defined(_M_X64)
+    _mm_prefetch((const char*)bucketOf(key), _MM_HINT_T0);
+#endif
+}
+
+// bench.cpp
+void runBench(const int depth);
+void runFillBench();
+void runThreadBench();
 
 // book.cpp
 void initBook();
@@ -310,7 +542,6 @@ uint64_t genPolyKey(const Board& board);
 int getBookMove(Board& board);
 
 // eval.cpp
-void initEvalMasks();
 int evaluatePos(Board& board);
 
 // move.cpp
@@ -325,29 +556,54 @@ bool isTwoSquarePush(const int move);
 bool isEnpassant(const int move);
 bool isCastling(const int move);
 std::string moveToStr(const int move);
+uint16_t packMove(const int move);
+int unpackMove(const uint16_t packed, const Board& board);
+std::string packedMoveToStr(const uint16_t packed);
 int parseMoveStr(const std::string& moveStr, const Board& board);
 void genAllMoves(MoveList& moveList, const Board& board);
 void genCaptureMoves(MoveList& moveList, const Board& board);
-void generatePawns(MoveList& moveList, const Board& board, MoveType moveType);
-void generateKnights(MoveList& moveList, const Board& board, MoveType moveType);
-void generateBishops(MoveList& moveList, const Board& board, MoveType moveType);
-void generateRooks(MoveList& moveList, const Board& board, MoveType moveType);
-void generateQueens(MoveList& moveList, const Board& board, MoveType moveType);
-void generateKings(MoveList& moveList, const Board& board, MoveType moveType);
+void genCheckInfo(CheckInfo& info, const Board& board);
+void generate(MoveList& moveList, const Board& board, MoveType moveType, const CheckInfo& info);
+bool isLegalMove(const Board& board, const CheckInfo& info, const int move);
+template <Color Us>
+void generatePawns(MoveList& moveList, const Board& board, MoveType moveType,
+                   const CheckInfo& info);
+template <Color Us>
+void generateKnights(MoveList& moveList, const Board& board, MoveType moveType,
+                     const CheckInfo& info);
+template <Color Us>
+void generateBishops(MoveList& moveList, const Board& board, MoveType moveType,
+                     const CheckInfo& info);
+template <Color Us>
+void generateRooks(MoveList& moveList, const Board& board, MoveType moveType,
+                   const CheckInfo& info);
+template <Color Us>
+void generateQueens(MoveList& moveList, const Board& board, MoveType moveType,
+                    const CheckInfo& info);
+template <Color Us>
+void generateKings(MoveList& moveList, const Board& board, MoveType moveType,
+                   const CheckInfo& info);
 void genWhiteCastling(MoveList& moveList, const Board& board);
 void genBlackCastling(MoveList& moveList, const Board& board);
-bool makeMove(Board* main, const int move, MoveType moveFlag);
+bool makeMove(Board* main, const int move, MoveType moveFlag, Undo& undo);
+void unmakeMove(Board* main, const int move, const Undo& undo);
+void makeNullMove(Board* main, Undo& undo);
+void unmakeNullMove(Board* main, const Undo& undo);
 
 // magics.cpp
-uint64_t random64();
-
-uint64_t findMagicNumber(const int sq, const int relevantBits, const PieceTypes piece);
-void initMagics();
+bool pextSupported();
+bool avx2Supported();
+SliderBackend detectSliderBackend();
+void setSliderBackend(const SliderBackend backend);
+int sliderIndex(const Magic& m, uint64_t blockerBoard);
 uint64_t getBishopAttack(const int sq, uint64_t blockerBoard);
 uint64_t getRookAttack(const int sq, uint64_t blockerBoard);
 uint64_t getQueenAttack(const int sq, uint64_t blockerBoard);
+uint64_t fillSliderAttacks(const uint64_t rooks, const uint64_t bishops, const uint64_t occupancy);
+int sliderMobility(const uint64_t rooks, const uint64_t bishops, const uint64_t occupancy);
 
 // perft.cpp
+void driver(Board& board, int depth, uint64_t& nodeCount, MoveType moveType);
 uint64_t perftTest(Board& board, const int depth, MoveType moveType);
 
 // tt.cpp
@@ -378,7 +634,6 @@ void printEngineOptions();
 void printHelpInfo();
 
 // zobrist.cpp
-void initZobrist();
 uint64_t genKey(const Board& board);
 uint64_t genLock(const Board& board);
 void updateZobristCastling(Board& board);
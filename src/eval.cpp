@@ -1,20 +1,8 @@
 #include "defs.hpp"
 #include "eval_consts.hpp"
 
-// file masks [square]
-uint64_t fileMasks[64];
-
-// rank masks [square]
-uint64_t rankMasks[64];
-
-// isolated pawn masks [square]
-uint64_t isolatedMasks[64];
-
-// white and black passed pawn masks [square]
-uint64_t passedMasks[2][64];
-
 // set file or rank mask
-uint64_t setFileRankMask(int file, int rank)
+static constexpr uint64_t setFileRankMask(int file, int rank)
 {
     uint64_t mask = 0ULL;
 
@@ -34,52 +22,74 @@ uint64_t setFileRankMask(int file, int rank)
     return mask;
 }
 
-// init evaluation masks
-void initEvalMasks()
+static constexpr std::array<uint64_t, 64> initFileMasks()
 {
-    int r = 0, f = 0;
+    std::array<uint64_t, 64> masks{};
+    for (int square = 0; square < 64; square++)
+        masks[square] = setFileRankMask(COL(square), -1);
+    return masks;
+}
 
-    for (r = 0; r < 8; r++) {
-        for (f = 0; f < 8; f++) {
-            int square = r * 8 + f;
-            /******** Init file masks ********/
-            fileMasks[square] |= setFileRankMask(f, -1);
-            /******** Init rank masks ********/
-            rankMasks[square] |= setFileRankMask(-1, r);
-        }
-    }
+static constexpr std::array<uint64_t, 64> initRankMasks()
+{
+    std::array<uint64_t, 64> masks{};
+    for (int square = 0; square < 64; square++)
+        masks[square] = setFileRankMask(-1, ROW(square));
+    return masks;
+}
 
-    for (r = 0; r < 8; r++) {
-        for (f = 0; f < 8; f++) {
-            int square = r * 8 + f;
+static constexpr std::array<uint64_t, 64> initIsolatedMasks()
+{
+    std::array<uint64_t, 64> masks{};
+    for (int square = 0; square < 64; square++)
+        masks[square] = setFileRankMask(COL(square) - 1, -1) | setFileRankMask(COL(square) + 1, -1);
+    return masks;
+}
 
-            /******** Init isolated masks ********/
-            isolatedMasks[square] |= setFileRankMask(f - 1, -1);
-            isolatedMasks[square] |= setFileRankMask(f + 1, -1);
+// file masks [square]
+static constexpr std::array<uint64_t, 64> fileMasks = initFileMasks();
+
+// rank masks [square]
+static constexpr std::array<uint64_t, 64> rankMasks = initRankMasks();
+
+// isolated pawn masks [square]
+static constexpr std::array<uint64_t, 64> isolatedMasks = initIsolatedMasks();
+
+static constexpr std::array<std::array<uint64_t, 64>, 2> initPassedMasks()
+{
+    std::array<std::array<uint64_t, 64>, 2> masks{};
+
+    for (int r = 0; r < 8; r++) {
+        for (int f = 0; f < 8; f++) {
+            int square = r * 8 + f;
 
             /******** White passed masks ********/
-            passedMasks[0][square] |= setFileRankMask(f - 1, -1);
-            passedMasks[0][square] |= setFileRankMask(f, -1);
-            passedMasks[0][square] |= setFileRankMask(f + 1, -1);
+            masks[0][square] |= setFileRankMask(f - 1, -1);
+            masks[0][square] |= setFileRankMask(f, -1);
+            masks[0][square] |= setFileRankMask(f + 1, -1);
 
             // loop over redudant ranks
             for (int i = 0; i < (8 - r); i++)
                 // reset redudant bits
-                passedMasks[0][square] &= ~rankMasks[(7 - i) * 8 + f];
+                masks[0][square] &= ~rankMasks[(7 - i) * 8 + f];
 
             /******** Black passed masks ********/
-            passedMasks[1][square] |= setFileRankMask(f - 1, -1);
-            passedMasks[1][square] |= setFileRankMask(f, -1);
-            passedMasks[1][square] |= setFileRankMask(f + 1, -1);
+            masks[1][square] |= setFileRankMask(f - 1, -1);
+            masks[1][square] |= setFileRankMask(f, -1);
+            masks[1][square] |= setFileRankMask(f + 1, -1);
 
             // loop over redudant ranks
             for (int i = 0; i < r + 1; i++)
                 // reset redudant bits
-                passedMasks[1][square] &= ~rankMasks[i * 8 + f];
+                masks[1][square] &= ~rankMasks[i * 8 + f];
         }
     }
+    return masks;
 }
 
+// white and black passed pawn masks [square]
+static constexpr std::array<std::array<uint64_t, 64>, 2> passedMasks = initPassedMasks();
+
 // get game phase score
 static inline int calcPhaseScore(Board& board)
 {
@@ -115,14 +125,13 @@ static bool areSameColoredBishops(Board& board, Color side)
     int sq = 0;
     int bishopColor = -1;
     while (bbCopy) {
-        sq = lsbIndex(bbCopy);
+        sq = popLsb(bbCopy);
         int prevColor = bishopColor;
         bishopColor = SQCLR(ROW(sq), COL(sq));
         if (prevColor != -1 && bishopColor != prevColor) {
             std::cout << "Same color!\n";
             return false;
         }
-        popBit(bbCopy, sq);
     }
     return true;
 }
@@ -195,6 +204,9 @@ int evaluatePos(Board& board)
     // penalties
     int doubledPawns = 0;
 
+    // number of squares the bishops or queens of a side attack, relative to an average
+    int mobility = 0;
+
     // loop over piece bitboards
     for (int piece = wP; piece <= bK; piece++) {
         // init piece bitboard copy
@@ -202,8 +214,8 @@ int evaluatePos(Board& board)
 
         // loop over pieces within a bitboard
         while (bbCopy) {
-            // init square
-            sq = lsbIndex(bbCopy);
+            // init square and pop ls1b
+            sq = popLsb(bbCopy);
 
             // get Opening/Endgame material score
             openingScore += MATERIAL_SCORE[Opening][piece];
@@ -254,12 +266,6 @@ int evaluatePos(Board& board)
                 // get Opening/Endgame positional score
                 openingScore += POSITIONAL_SCORE[Opening][BISHOP][sq];
                 endgameScore += POSITIONAL_SCORE[Endgame][BISHOP][sq];
-
-                // mobility
-                openingScore += (countBits(getBishopAttack(sq, board.units[BOTH])) - BISHOP_UNIT) *
-                                BISHOP_MOBILITY_OPENING;
-                endgameScore += (countBits(getBishopAttack(sq, board.units[BOTH])) - BISHOP_UNIT) *
-                                BISHOP_MOBILITY_ENDGAME;
                 break;
 
             // evaluate white rooks
@@ -289,12 +295,6 @@ int evaluatePos(Board& board)
                 // get Opening/Endgame positional score
                 openingScore += POSITIONAL_SCORE[Opening][QUEEN][sq];
                 endgameScore += POSITIONAL_SCORE[Endgame][QUEEN][sq];
-
-                // mobility
-                openingScore += (countBits(getQueenAttack(sq, board.units[BOTH])) - QUEEN_UNIT) *
-                                QUEEN_MOBILITY_OPENING;
-                endgameScore += (countBits(getQueenAttack(sq, board.units[BOTH])) - QUEEN_UNIT) *
-                                QUEEN_MOBILITY_ENDGAME;
                 break;
 
             // evaluate white king
@@ -366,12 +366,6 @@ int evaluatePos(Board& board)
                 // get Opening/Endgame positional score
                 openingScore -= POSITIONAL_SCORE[Opening][BISHOP][MIRROR_SCORE[sq]];
                 endgameScore -= POSITIONAL_SCORE[Endgame][BISHOP][MIRROR_SCORE[sq]];
-
-                // mobility
-                openingScore -= (countBits(getBishopAttack(sq, board.units[BOTH])) - BISHOP_UNIT) *
-                                BISHOP_MOBILITY_OPENING;
-                endgameScore -= (countBits(getBishopAttack(sq, board.units[BOTH])) - BISHOP_UNIT) *
-                                BISHOP_MOBILITY_ENDGAME;
                 break;
 
             // evaluate black rooks
@@ -401,12 +395,6 @@ int evaluatePos(Board& board)
                 // get Opening/Endgame positional score
                 openingScore -= POSITIONAL_SCORE[Opening][QUEEN][MIRROR_SCORE[sq]];
                 endgameScore -= POSITIONAL_SCORE[Endgame][QUEEN][MIRROR_SCORE[sq]];
-
-                // mobility
-                openingScore -= (countBits(getQueenAttack(sq, board.units[BOTH])) - QUEEN_UNIT) *
-                                QUEEN_MOBILITY_OPENING;
-                endgameScore -= (countBits(getQueenAttack(sq, board.units[BOTH])) - QUEEN_UNIT) *
-                                QUEEN_MOBILITY_ENDGAME;
                 break;
 
             // evaluate black king
@@ -434,12 +422,28 @@ int evaluatePos(Board& board)
                 endgameScore -= countBits(kingAttacks[sq] & board.units[BLACK]) * KING_SHIELD_BONUS;
                 break;
             }
-
-            // pop ls1b
-            popBit(bbCopy, sq);
         }
     }
 
+    // mobility, counted for all the bishops and all the queens of a side at once
+    mobility = sliderMobility(0ULL, board.pieces[wB], board.units[BOTH]) -
+               countBits(board.pieces[wB]) * BISHOP_UNIT;
+    openingScore += mobility * BISHOP_MOBILITY_OPENING;
+    endgameScore += mobility * BISHOP_MOBILITY_ENDGAME;
+    mobility = sliderMobility(board.pieces[wQ], board.pieces[wQ], board.units[BOTH]) -
+               countBits(board.pieces[wQ]) * QUEEN_UNIT;
+    openingScore += mobility * QUEEN_MOBILITY_OPENING;
+    endgameScore += mobility * QUEEN_MOBILITY_ENDGAME;
+
+    mobility = sliderMobility(0ULL, board.pieces[bB], board.units[BOTH]) -
+               countBits(board.pieces[bB]) * BISHOP_UNIT;
+    openingScore -= mobility * BISHOP_MOBILITY_OPENING;
+    endgameScore -= mobility * BISHOP_MOBILITY_ENDGAME;
+    mobility = sliderMobility(board.pieces[bQ], board.pieces[bQ], board.units[BOTH]) -
+               countBits(board.pieces[bQ]) * QUEEN_UNIT;
+    openingScore -= mobility * QUEEN_MOBILITY_OPENING;
+    endgameScore -= mobility * QUEEN_MOBILITY_ENDGAME;
+
     /*
         Now in order to calculate interpolated score
         for a given game phase we use this formula
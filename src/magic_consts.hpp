@@ -0,0 +1,70 @@
+#pragma once
+
+// Generated by tools/magicgen (seed 1804289383, dense attempts 0), don't edit
+// Magic lookups use 5248 bishop and 102400 rook attack entries
+
+#include <cstdint>
+
+// clang-format off
+const uint64_t BISHOP_MAGICS[64] = {
+    0x01a141100a008020ULL, 0x00a9010804910000ULL, 0x108408020c404803ULL, 0x0018060042009000ULL,
+    0x0014050430200000ULL, 0x2104901028004400ULL, 0x4101280124200081ULL, 0x888100222a200400ULL,
+    0x0020041010461480ULL, 0x404520010401004cULL, 0x80080808812a0000ULL, 0x20a402208e020001ULL,
+    0x0008060a10040950ULL, 0x0504220150080010ULL, 0x2000008404608400ULL, 0x2200028044100540ULL,
+    0x4004084010224200ULL, 0x0102c2240c082200ULL, 0x1102085004004008ULL, 0x2008040082004008ULL,
+    0x0424824400a00020ULL, 0x0089000c20a01040ULL, 0x0041020200822000ULL, 0x0060800100809000ULL,
+    0x0221089104080802ULL, 0x1110100618c20a80ULL, 0x5243440440450200ULL, 0xc540040000410021ULL,
+    0x0001010020104000ULL, 0x030600200c100800ULL, 0x2018408045040908ULL, 0x1004048c01005512ULL,
+    0x0282182000402280ULL, 0x0004103810124200ULL, 0x0804040a001c0024ULL, 0x0004400808408200ULL,
+    0x1840010010090040ULL, 0x0002081240020060ULL, 0x0048888085140600ULL, 0x0020c89280220200ULL,
+    0x0028047218022124ULL, 0x0800861120021010ULL, 0x000b040202000102ULL, 0x0082205144000800ULL,
+    0x0100084104008042ULL, 0x0002500a22001020ULL, 0x00100200a4100100ULL, 0x4404880084200100ULL,
+    0x8002220220842100ULL, 0x0e04404404600400ULL, 0x0200250401040004ULL, 0x0004052046080001ULL,
+    0x1008001002021008ULL, 0x8902912021010110ULL, 0x0204040812041880ULL, 0x11702200a9060008ULL,
+    0x0820840402010420ULL, 0x4004804220842000ULL, 0x040040d1040a1600ULL, 0x10030580002a0804ULL,
+    0x0889001c100a0e02ULL, 0x0800802060020221ULL, 0x3000082024488204ULL, 0x00a0088200840c10ULL,
+};
+
+// Index bits of each bishop magic
+const int BISHOP_MAGIC_BITS[64] = {
+     6,  5,  5,  5,  5,  5,  5,  6,
+     5,  5,  5,  5,  5,  5,  5,  5,
+     5,  5,  7,  7,  7,  7,  5,  5,
+     5,  5,  7,  9,  9,  7,  5,  5,
+     5,  5,  7,  9,  9,  7,  5,  5,
+     5,  5,  7,  7,  7,  7,  5,  5,
+     5,  5,  5,  5,  5,  5,  5,  5,
+     6,  5,  5,  5,  5,  5,  5,  6,
+};
+
+const uint64_t ROOK_MAGICS[64] = {
+    0x4b80001040048022ULL, 0x0040400020001000ULL, 0x8100100900200042ULL, 0x4080100004080082ULL,
+    0x0600242010181a00ULL, 0x0280111200800400ULL, 0x8880010024800600ULL, 0x8100004080221100ULL,
+    0x0082002100420080ULL, 0x0082400050002000ULL, 0x1010802000100082ULL, 0x4000800800100080ULL,
+    0x0cc0808008000400ULL, 0x4611808002001400ULL, 0xe840800100020080ULL, 0x0406000202470084ULL,
+    0x8002888004400020ULL, 0x0020014010004022ULL, 0x004182806000d000ULL, 0x8018008010040880ULL,
+    0x0404010100100800ULL, 0x5401010004000208ULL, 0x2010040028b01211ULL, 0x6000020010804114ULL,
+    0x0880004040002000ULL, 0x0030044240002001ULL, 0x0080200100110040ULL, 0x0201100300210008ULL,
+    0x0000100500080100ULL, 0x280c008080020004ULL, 0xcc08010400880210ULL, 0x4020440200008041ULL,
+    0x04c0008022800241ULL, 0x0020401080802004ULL, 0x0000450011002000ULL, 0x1040808802801000ULL,
+    0x2048800400800800ULL, 0x0082000402001008ULL, 0x0040024104009008ULL, 0xa20500440a002881ULL,
+    0x0080002000414000ULL, 0x0050004020014000ULL, 0xa030080024002000ULL, 0x0290000804004040ULL,
+    0x0081000800110004ULL, 0x0018020004008080ULL, 0x000a010002008080ULL, 0x0003000040810002ULL,
+    0x0180008102422300ULL, 0x281280204a010200ULL, 0x0810015160008380ULL, 0x0008810800100180ULL,
+    0x1004000800800480ULL, 0x0000040002008080ULL, 0x0000100738064400ULL, 0x3000093044008200ULL,
+    0x800100314482e202ULL, 0x001e028040a0110aULL, 0x0020200410418901ULL, 0x000c100100082005ULL,
+    0x0042002004100802ULL, 0x0001000400080201ULL, 0x8144021000e10804ULL, 0x000200240080490aULL,
+};
+
+// Index bits of each rook magic
+const int ROOK_MAGIC_BITS[64] = {
+    12, 11, 11, 11, 11, 11, 11, 12,
+    11, 10, 10, 10, 10, 10, 10, 11,
+    11, 10, 10, 10, 10, 10, 10, 11,
+    11, 10, 10, 10, 10, 10, 10, 11,
+    11, 10, 10, 10, 10, 10, 10, 11,
+    11, 10, 10, 10, 10, 10, 10, 11,
+    11, 10, 10, 10, 10, 10, 10, 11,
+    12, 11, 11, 11, 11, 11, 11, 12,
+};
+// clang-format on
@@ -9,6 +9,12 @@ void runTests()
 {
     test::parseFen();
     test::polyKeyGeneration();
+    test::perft();
+    test::legalMoveCheck();
+    test::staticExchange();
+    test::attackMaps();
+    test::sliderAttacks();
+    test::transpositionTable();
 }
 
 int main()
@@ -17,9 +23,7 @@ int main()
 
     initAttacks();
     initBook();
-	initEvalMasks();
 	hashTable.init(DEFAULT_TT_SIZE);
-    initZobrist();
 #if TEST == 1
     runTests();
 #else
@@ -1,14 +1,8 @@
 #include "defs.hpp"
 
-MoveList::MoveList()
-{
-    memset(list, 0, sizeof(list));
-    count = 0;
-}
-
 void MoveList::add(const int move)
 {
-    list[count] = move;
+    list[count].move = move;
     count++;
 }
 
@@ -81,6 +75,60 @@ std::string moveToStr(const int move)
     return moveStr;
 }
 
+/*
+        Packed (16-bit) move layout, used where moves are stored rather than played
+          bits  0-5   source square (same as a full move)
+          bits  6-11  target square (same as a full move)
+          bits 12-13  promoted piece type (0 = knight ... 3 = queen)
+          bits 14-15  special move flag (PackedMoveFlag)
+        The moving piece, capture and two square push are taken from the board when unpacking.
+*/
+uint16_t packMove(const int move)
+{
+    if (move == 0)
+        return 0;
+
+    uint16_t packed = (uint16_t)(move & 0xFFF);
+    int promoted = getPromoted(move);
+    if (promoted != EMPTY)
+        packed |= ((COLORLESS(promoted) - KNIGHT) << 12) | (PM_PROMOTION << 14);
+    else if (isEnpassant(move))
+        packed |= PM_ENPASSANT << 14;
+    else if (isCastling(move))
+        packed |= PM_CASTLING << 14;
+    return packed;
+}
+
+// The result is only legal if the packed move was made in this position, see isLegalMove()
+int unpackMove(const uint16_t packed, const Board& board)
+{
+    int source = getSource(packed);
+    int target = getTarget(packed);
+    int piece = board.pieceOn(source);
+    if (packed == 0 || piece == EMPTY)
+        return 0;
+
+    int flag = packed >> 14;
+    int promoted = EMPTY;
+    if (flag == PM_PROMOTION)
+        promoted = ((packed >> 12) & 3) + KNIGHT + (piece >= bP ? 6 : 0);
+    bool enpassant = flag == PM_ENPASSANT;
+    bool capture = enpassant || board.pieceOn(target) != EMPTY;
+    bool twoSquarePush = COLORLESS(piece) == PAWN && abs(target - source) == 16;
+
+    return encode(source, target, piece, promoted, capture, twoSquarePush, enpassant,
+                  flag == PM_CASTLING);
+}
+
+std::string packedMoveToStr(const uint16_t packed)
+{
+    std::string moveStr = STR_COORDS[getSource(packed)];
+    moveStr += STR_COORDS[getTarget(packed)];
+    if ((packed >> 14) == PM_PROMOTION)
+        moveStr += "nbrq"[(packed >> 12) & 3];
+    return moveStr;
+}
+
 int parseMoveStr(const std::string& moveStr, const Board& board)
 {
     int source = SQ((8 - (moveStr[1] - '0')), (moveStr[0] - 'a'));
@@ -97,223 +145,298 @@ int parseMoveStr(const std::string& moveStr, const Board& board)
     return searchedMove;
 }
 
-static void generate(MoveList& moveList, const Board& board, MoveType moveType)
+void genCheckInfo(CheckInfo& info, const Board& board)
 {
-    moveList = MoveList();
-    generatePawns(moveList, board, moveType);
-    generateKnights(moveList, board, moveType);
-    generateBishops(moveList, board, moveType);
-    generateRooks(moveList, board, moveType);
-    generateQueens(moveList, board, moveType);
-    generateKings(moveList, board, moveType);
+    Color enemy = (Color)(board.side ^ 1);
+    int enemyOffset = enemy == WHITE ? 0 : 6;
+    uint64_t enemyRooks = board.pieces[wR + enemyOffset] | board.pieces[wQ + enemyOffset];
+    uint64_t enemyBishops = board.pieces[wB + enemyOffset] | board.pieces[wQ + enemyOffset];
+
+    info.kingSq = lsbIndex(board.pieces[board.side == WHITE ? wK : bK]);
+
+    // Enemy pieces that attack the king
+    info.checkers = (pawnAttacks[board.side][info.kingSq] & board.pieces[wP + enemyOffset]) |
+                    (knightAttacks[info.kingSq] & board.pieces[wN + enemyOffset]) |
+                    (getBishopAttack(info.kingSq, board.units[BOTH]) & enemyBishops) |
+                    (getRookAttack(info.kingSq, board.units[BOTH]) & enemyRooks);
+
+    // Single check: capture the checker or block its path
+    // Double check: only the king can move
+    if (info.checkers == 0)
+        info.checkMask = ~0ULL;
+    else if ((info.checkers & (info.checkers - 1)) == 0)
+        info.checkMask = squaresBetween[info.kingSq][lsbIndex(info.checkers)] | info.checkers;
+    else
+        info.checkMask = 0ULL;
+
+    // Own pieces that are the only blocker between an enemy slider and the king
+    info.pinned = 0ULL;
+    uint64_t snipers = (getRookAttack(info.kingSq, board.units[enemy]) & enemyRooks) |
+                       (getBishopAttack(info.kingSq, board.units[enemy]) & enemyBishops);
+    while (snipers) {
+        int sniperSq = popLsb(snipers);
+        uint64_t blockers = squaresBetween[info.kingSq][sniperSq] & board.units[BOTH];
+        if (blockers && (blockers & (blockers - 1)) == 0 && (blockers & board.units[board.side]))
+            info.pinned |= blockers;
+    }
 }
 
-void genAllMoves(MoveList& moveList, const Board& board) { generate(moveList, board, AllMoves); }
+// Squares a piece on 'source' can move to without exposing its own king
+static uint64_t legalTargets(const CheckInfo& info, const int source)
+{
+    if (getBit(info.pinned, source))
+        return info.checkMask & lineThrough[info.kingSq][source];
+    return info.checkMask;
+}
 
-void genCaptureMoves(MoveList& moveList, const Board& board) { generate(moveList, board, OnlyCaptures); }
+// Squares the pieces of side 'Us' may move to for the requested type of moves
+template <Color Us> static uint64_t moveTargets(const Board& board, MoveType moveType)
+{
+    constexpr Color Them = Us == WHITE ? BLACK : WHITE;
+    if (moveType == OnlyCaptures)
+        return board.units[Them];
+    if (moveType == OnlyQuiets)
+        return ~board.units[BOTH];
+    return ~board.units[Us];
+}
 
-void generatePawns(MoveList& moveList, const Board& board, MoveType moveType)
+template <Color Us>
+static void generateAll(MoveList& moveList, const Board& board, MoveType moveType,
+                        const CheckInfo& info)
 {
-    uint64_t bitboardCopy, attackCopy;
-    int promotionStart, direction, doublePushStart, piece;
-    int source, target;
-    // If side to move is white
-    if (board.side == WHITE) {
-        piece = wP;
-        promotionStart = A7;
-        direction = SOUTH;
-        doublePushStart = A2;
-    }
-    // If side to move is black
-    else {
-        piece = bP;
-        promotionStart = A2;
-        direction = NORTH;
-        doublePushStart = A7;
+    // In double check, only king moves are legal
+    if (info.checkMask) {
+        generatePawns<Us>(moveList, board, moveType, info);
+        generateKnights<Us>(moveList, board, moveType, info);
+        generateBishops<Us>(moveList, board, moveType, info);
+        generateRooks<Us>(moveList, board, moveType, info);
+        generateQueens<Us>(moveList, board, moveType, info);
     }
+    generateKings<Us>(moveList, board, moveType, info);
+}
+
+void generate(MoveList& moveList, const Board& board, MoveType moveType, const CheckInfo& info)
+{
+    moveList.count = 0;
+
+    // The side to move is resolved once here, the generators are specialized for each color
+    if (board.side == WHITE)
+        generateAll<WHITE>(moveList, board, moveType, info);
+    else
+        generateAll<BLACK>(moveList, board, moveType, info);
+}
+
+void genAllMoves(MoveList& moveList, const Board& board)
+{
+    CheckInfo info;
+    genCheckInfo(info, board);
+    generate(moveList, board, AllMoves, info);
+}
+
+void genCaptureMoves(MoveList& moveList, const Board& board)
+{
+    CheckInfo info;
+    genCheckInfo(info, board);
+    generate(moveList, board, OnlyCaptures, info);
+}
+
+// Checks if an enpassant capture leaves the king attacked by a slider, which can happen when both
+// pawns leave the king's rank or when the capturing pawn is pinned
+template <Color Us>
+static bool isEnpassantLegal(const Board& board, const CheckInfo& info, const int source,
+                             const int target)
+{
+    constexpr int enemyOffset = Us == WHITE ? 6 : 0;
+    int capturedSq = target + (Us == WHITE ? NORTH : SOUTH);
+
+    // When in check, the capture has to take the checking pawn or block the check
+    if (!(info.checkMask & ((1ULL << target) | (1ULL << capturedSq))))
+        return false;
+
+    uint64_t occupancy =
+        (board.units[BOTH] ^ (1ULL << source) ^ (1ULL << capturedSq)) | (1ULL << target);
+
+    return !(getRookAttack(info.kingSq, occupancy) &
+             (board.pieces[wR + enemyOffset] | board.pieces[wQ + enemyOffset])) &&
+           !(getBishopAttack(info.kingSq, occupancy) &
+             (board.pieces[wB + enemyOffset] | board.pieces[wQ + enemyOffset]));
+}
 
-    bitboardCopy = board.pieces[piece];
+template <Color Us>
+void generatePawns(MoveList& moveList, const Board& board, MoveType moveType,
+                   const CheckInfo& info)
+{
+    constexpr Color Them = Us == WHITE ? BLACK : WHITE;
+    constexpr int piece = Us == WHITE ? wP : bP;
+    constexpr int promotionStart = Us == WHITE ? A7 : A2;
+    constexpr int direction = Us == WHITE ? SOUTH : NORTH;
+    constexpr int doublePushStart = Us == WHITE ? A2 : A7;
+    constexpr int queen = Us == WHITE ? wQ : bQ, rook = Us == WHITE ? wR : bR;
+    constexpr int bishop = Us == WHITE ? wB : bB, knight = Us == WHITE ? wN : bN;
+
+    uint64_t bitboardCopy = board.pieces[piece], attackCopy, targets;
+    int source, target;
 
     while (bitboardCopy) {
-        source = lsbIndex(bitboardCopy);
+        source = popLsb(bitboardCopy);
         target = source + direction;
-        if (moveType != OnlyCaptures) {
-			if ((board.side == WHITE ? target >= A8 : target <= H1) &&
-				!getBit(board.units[BOTH], target)) {
-				// Quiet moves
-				// Promotion
-				if ((source >= promotionStart) && (source <= promotionStart + 7)) {
-					moveList.add(
-						encode(source, target, piece, (board.side == WHITE ? wQ : bQ), 0, 0, 0, 0));
-					moveList.add(
-						encode(source, target, piece, (board.side == WHITE ? wR : bR), 0, 0, 0, 0));
-					moveList.add(
-						encode(source, target, piece, (board.side == WHITE ? wB : bB), 0, 0, 0, 0));
-					moveList.add(
-						encode(source, target, piece, (board.side == WHITE ? wN : bN), 0, 0, 0, 0));
-				} else {
-					moveList.add(encode(source, target, piece, EMPTY, 0, 0, 0, 0));
-					if ((source >= doublePushStart && source <= doublePushStart + 7) &&
-						!getBit(board.units[BOTH], target + direction))
-						moveList.add(encode(source, target + direction, piece, EMPTY, 0, 1, 0, 0));
-				}
-			}
+        targets = legalTargets(info, source);
+        if (moveType != OnlyCaptures && !getBit(board.units[BOTH], target)) {
+            // Quiet moves
+            // Promotion
+            if ((source >= promotionStart) && (source <= promotionStart + 7)) {
+                if (getBit(targets, target)) {
+                    moveList.add(encode(source, target, piece, queen, 0, 0, 0, 0));
+                    moveList.add(encode(source, target, piece, rook, 0, 0, 0, 0));
+                    moveList.add(encode(source, target, piece, bishop, 0, 0, 0, 0));
+                    moveList.add(encode(source, target, piece, knight, 0, 0, 0, 0));
+                }
+            } else {
+                if (getBit(targets, target))
+                    moveList.add(encode(source, target, piece, EMPTY, 0, 0, 0, 0));
+                if ((source >= doublePushStart && source <= doublePushStart + 7) &&
+                    !getBit(board.units[BOTH], target + direction) &&
+                    getBit(targets, target + direction))
+                    moveList.add(encode(source, target + direction, piece, EMPTY, 0, 1, 0, 0));
+            }
         }
+        if (moveType == OnlyQuiets)
+            continue;
         // Capture moves
-        attackCopy = pawnAttacks[board.side][source] & board.units[board.side ^ 1];
+        attackCopy = pawnAttacks[Us][source] & board.units[Them] & targets;
         while (attackCopy) {
-            target = lsbIndex(attackCopy);
+            target = popLsb(attackCopy);
             // Capture move
             if ((source >= promotionStart) && (source <= promotionStart + 7)) {
-                moveList.add(
-                    encode(source, target, piece, (board.side == WHITE ? wQ : bQ), 1, 0, 0, 0));
-                moveList.add(
-                    encode(source, target, piece, (board.side == WHITE ? wR : bR), 1, 0, 0, 0));
-                moveList.add(
-                    encode(source, target, piece, (board.side == WHITE ? wB : bB), 1, 0, 0, 0));
-                moveList.add(
-                    encode(source, target, piece, (board.side == WHITE ? wN : bN), 1, 0, 0, 0));
+                moveList.add(encode(source, target, piece, queen, 1, 0, 0, 0));
+                moveList.add(encode(source, target, piece, rook, 1, 0, 0, 0));
+                moveList.add(encode(source, target, piece, bishop, 1, 0, 0, 0));
+                moveList.add(encode(source, target, piece, knight, 1, 0, 0, 0));
             } else
                 moveList.add(encode(source, target, piece, EMPTY, 1, 0, 0, 0));
-            // Remove 'source' bit
-            popBit(attackCopy, target);
         }
         // Generate enpassant capture
         if (board.enpassant != NOSQ) {
-            uint64_t enpassCapture = pawnAttacks[board.side][source] & (1ULL << board.enpassant);
-            if (enpassCapture) {
+            uint64_t enpassCapture = pawnAttacks[Us][source] & (1ULL << board.enpassant);
+            if (enpassCapture && isEnpassantLegal<Us>(board, info, source, board.enpassant)) {
                 int enpassTarget = lsbIndex(enpassCapture);
                 moveList.add(encode(source, enpassTarget, piece, EMPTY, 1, 0, 1, 0));
             }
         }
-        // Remove bits
-        popBit(bitboardCopy, source);
     }
 }
 
-void generateKnights(MoveList& moveList, const Board& board, MoveType moveType)
+template <Color Us>
+void generateKnights(MoveList& moveList, const Board& board, MoveType moveType,
+                     const CheckInfo& info)
 {
-    int source, target, piece = board.side == WHITE ? wN : bN;
-    uint64_t bitboardCopy = board.pieces[piece], attackCopy;
+    constexpr Color Them = Us == WHITE ? BLACK : WHITE;
+    constexpr int piece = Us == WHITE ? wN : bN;
+    int source, target;
+    uint64_t bitboardCopy = board.pieces[piece] & ~info.pinned, attackCopy;
+    uint64_t targets = moveTargets<Us>(board, moveType) & info.checkMask;
     while (bitboardCopy) {
-        source = lsbIndex(bitboardCopy);
+        source = popLsb(bitboardCopy);
 
-        attackCopy = knightAttacks[source] & (~board.units[board.side]);
+        attackCopy = knightAttacks[source] & targets;
         while (attackCopy) {
-            target = lsbIndex(attackCopy);
-            bool isCapture = getBit(board.units[board.side == WHITE ? BLACK : WHITE], target);
-            if (!isCapture && moveType == OnlyCaptures) {
-				popBit(attackCopy, target);
-                continue;
-            }
-			moveList.add(encode(source, target, piece, EMPTY, isCapture, 0, 0, 0));
-            popBit(attackCopy, target);
+            target = popLsb(attackCopy);
+            moveList.add(encode(source, target, piece, EMPTY, getBit(board.units[Them], target), 0,
+                                0, 0));
         }
-        popBit(bitboardCopy, source);
     }
 }
 
-void generateBishops(MoveList& moveList, const Board& board, MoveType moveType)
+template <Color Us>
+void generateBishops(MoveList& moveList, const Board& board, MoveType moveType,
+                     const CheckInfo& info)
 {
-    int source, target, piece = board.side == WHITE ? wB : bB;
+    constexpr Color Them = Us == WHITE ? BLACK : WHITE;
+    constexpr int piece = Us == WHITE ? wB : bB;
+    int source, target;
     uint64_t bitboardCopy = board.pieces[piece], attackCopy;
+    uint64_t targets = moveTargets<Us>(board, moveType);
     while (bitboardCopy) {
-        source = lsbIndex(bitboardCopy);
+        source = popLsb(bitboardCopy);
 
-        attackCopy = getBishopAttack(source, board.units[BOTH]) &
-                     (board.side == WHITE ? ~board.units[WHITE] : ~board.units[BLACK]);
+        attackCopy =
+            getBishopAttack(source, board.units[BOTH]) & targets & legalTargets(info, source);
         while (attackCopy) {
-            target = lsbIndex(attackCopy);
-            bool isCapture = getBit(board.units[board.side == WHITE ? BLACK : WHITE], target);
-            if (!isCapture && moveType == OnlyCaptures) {
-				popBit(attackCopy, target);
-                continue;
-            }
-			moveList.add(encode(source, target, piece, EMPTY, isCapture, 0, 0, 0));
-            popBit(attackCopy, target);
+            target = popLsb(attackCopy);
+            moveList.add(encode(source, target, piece, EMPTY, getBit(board.units[Them], target), 0,
+                                0, 0));
         }
-        popBit(bitboardCopy, source);
     }
 }
 
-void generateRooks(MoveList& moveList, const Board& board, MoveType moveType)
+template <Color Us>
+void generateRooks(MoveList& moveList, const Board& board, MoveType moveType,
+                   const CheckInfo& info)
 {
-    int source, target, piece = board.side == WHITE ? wR : bR;
+    constexpr Color Them = Us == WHITE ? BLACK : WHITE;
+    constexpr int piece = Us == WHITE ? wR : bR;
+    int source, target;
     uint64_t bitboardCopy = board.pieces[piece], attackCopy;
+    uint64_t targets = moveTargets<Us>(board, moveType);
     while (bitboardCopy) {
-        source = lsbIndex(bitboardCopy);
+        source = popLsb(bitboardCopy);
 
-        attackCopy = getRookAttack(source, board.units[BOTH]) &
-                     (board.side == WHITE ? ~board.units[WHITE] : ~board.units[BLACK]);
+        attackCopy =
+            getRookAttack(source, board.units[BOTH]) & targets & legalTargets(info, source);
         while (attackCopy) {
-            target = lsbIndex(attackCopy);
-            bool isCapture = getBit(board.units[board.side == WHITE ? BLACK : WHITE], target);
-            if (!isCapture && moveType == OnlyCaptures) {
-				popBit(attackCopy, target);
-                continue;
-            }
-			moveList.add(encode(source, target, piece, EMPTY, isCapture, 0, 0, 0));
-            popBit(attackCopy, target);
+            target = popLsb(attackCopy);
+            moveList.add(encode(source, target, piece, EMPTY, getBit(board.units[Them], target), 0,
+                                0, 0));
         }
-        popBit(bitboardCopy, source);
     }
 }
 
-void generateQueens(MoveList& moveList, const Board& board, MoveType moveType)
+template <Color Us>
+void generateQueens(MoveList& moveList, const Board& board, MoveType moveType,
+                    const CheckInfo& info)
 {
-    int source, target, piece = board.side == WHITE ? wQ : bQ;
+    constexpr Color Them = Us == WHITE ? BLACK : WHITE;
+    constexpr int piece = Us == WHITE ? wQ : bQ;
+    int source, target;
     uint64_t bitboardCopy = board.pieces[piece], attackCopy;
+    uint64_t targets = moveTargets<Us>(board, moveType);
     while (bitboardCopy) {
-        source = lsbIndex(bitboardCopy);
+        source = popLsb(bitboardCopy);
 
-        attackCopy = getQueenAttack(source, board.units[BOTH]) &
-                     (board.side == WHITE ? ~board.units[WHITE] : ~board.units[BLACK]);
+        attackCopy =
+            getQueenAttack(source, board.units[BOTH]) & targets & legalTargets(info, source);
         while (attackCopy) {
-            target = lsbIndex(attackCopy);
-            bool isCapture = getBit(board.units[board.side == WHITE ? BLACK : WHITE], target);
-            if (!isCapture && moveType == OnlyCaptures) {
-				popBit(attackCopy, target);
-                continue;
-            }
-			moveList.add(encode(source, target, piece, EMPTY, isCapture, 0, 0, 0));
-            popBit(attackCopy, target);
+            target = popLsb(attackCopy);
+            moveList.add(encode(source, target, piece, EMPTY, getBit(board.units[Them], target), 0,
+                                0, 0));
         }
-        popBit(bitboardCopy, source);
     }
 }
 
-void generateKings(MoveList& moveList, const Board& board, MoveType moveType)
+template <Color Us>
+void generateKings(MoveList& moveList, const Board& board, MoveType moveType,
+                   const CheckInfo& info)
 {
-    /* NOTE: Checks aren't handled by the move generator,
-             it's handled by the make move function.
-    */
-    int source, target, piece = board.side == WHITE ? wK : bK;
-    uint64_t bitboard = board.pieces[piece], attackCopy;
-    while (bitboard != 0) {
-        source = lsbIndex(bitboard);
-
-        attackCopy =
-            kingAttacks[source] & (board.side == WHITE ? ~board.units[WHITE] : ~board.units[BLACK]);
-        while (attackCopy != 0) {
-            target = lsbIndex(attackCopy);
-            bool isCapture = getBit(board.units[board.side == WHITE ? BLACK : WHITE], target);
-            if (!isCapture && moveType == OnlyCaptures) {
-				popBit(attackCopy, target);
-                continue;
-            }
-			moveList.add(encode(source, target, piece, EMPTY, isCapture, 0, 0, 0));
-            // Remove target bit to move onto the next bit
-            popBit(attackCopy, target);
-        }
-        // Remove source bit to move onto the next bit
-        popBit(bitboard, source);
+    constexpr Color Them = Us == WHITE ? BLACK : WHITE;
+    constexpr int piece = Us == WHITE ? wK : bK;
+    int source, target;
+    // The king can't hide behind itself from a slider, so it's removed from the occupancy
+    uint64_t occupancy = board.units[BOTH] & ~board.pieces[piece], attackCopy;
+
+    source = info.kingSq;
+    attackCopy = kingAttacks[source] & moveTargets<Us>(board, moveType);
+    while (attackCopy != 0) {
+        target = popLsb(attackCopy);
+        if (!board.sqAttacked<Them>((Sq)target, occupancy))
+            moveList.add(encode(source, target, piece, EMPTY, getBit(board.units[Them], target),
+                                0, 0, 0));
     }
     // Generate castling moves
-    if (moveType != OnlyCaptures) {
-		if (board.side == WHITE)
-			genWhiteCastling(moveList, board);
-		else
-			genBlackCastling(moveList, board);
+    if (moveType != OnlyCaptures && !info.checkers) {
+        if constexpr (Us == WHITE)
+            genWhiteCastling(moveList, board);
+        else
+            genBlackCastling(moveList, board);
     }
 }
 
@@ -322,19 +445,20 @@ void genWhiteCastling(MoveList& moveList, const Board& board)
 	// Kingside castling
 	if (board.castling & (1 << c_wk)) {
 		// Check if path is obstructed
-		if (!getBit(board.units[BOTH], F1) && !getBit(board.units[BOTH], G1)) {
-			// Is e1 or f1 attacked by a black piece?
-			if (!board.sqAttacked(E1, BLACK) && !board.sqAttacked(F1, BLACK))
+		if (!(board.units[BOTH] & squaresBetween[E1][H1])) {
+			// Is f1 or g1 attacked by a black piece? (e1 isn't, since the king isn't in check)
+			if (!board.sqAttacked<BLACK>(F1, board.units[BOTH]) &&
+				!board.sqAttacked<BLACK>(G1, board.units[BOTH]))
 				moveList.add(encode(E1, G1, wK, EMPTY, 0, 0, 0, 1));
 		}
 	}
 	// Queenside castling
 	if (getBit(board.castling, c_wq)) {
 		// Check if path is obstructed
-		if (!getBit(board.units[BOTH], B1) && !getBit(board.units[BOTH], C1) &&
-			!getBit(board.units[BOTH], D1)) {
-			// Is d1 or e1 attacked by a black piece?
-			if (!board.sqAttacked(D1, BLACK) && !board.sqAttacked(E1, BLACK))
+		if (!(board.units[BOTH] & squaresBetween[E1][A1])) {
+			// Is c1 or d1 attacked by a black piece?
+			if (!board.sqAttacked<BLACK>(C1, board.units[BOTH]) &&
+				!board.sqAttacked<BLACK>(D1, board.units[BOTH]))
 				moveList.add(encode(E1, C1, wK, EMPTY, 0, 0, 0, 1));
 		}
 	}
@@ -344,28 +468,180 @@ void genBlackCastling(MoveList& moveList, const Board& board)
     // Kingside castling
     if (getBit(board.castling, c_bk)) {
         // Check if path is obstructed
-        if (!getBit(board.units[BOTH], F8) && !getBit(board.units[BOTH], G8)) {
-            // Is e8 or f8 attacked by a white piece?
-            if (!board.sqAttacked(E8, WHITE) && !board.sqAttacked(F8, WHITE))
+        if (!(board.units[BOTH] & squaresBetween[E8][H8])) {
+            // Is f8 or g8 attacked by a white piece? (e8 isn't, since the king isn't in check)
+            if (!board.sqAttacked<WHITE>(F8, board.units[BOTH]) &&
+                !board.sqAttacked<WHITE>(G8, board.units[BOTH]))
                 moveList.add(encode(E8, G8, bK, EMPTY, 0, 0, 0, 1));
         }
     }
     // Queenside castling
     if (getBit(board.castling, c_bq)) {
         // Check if path is obstructed
-        if (!getBit(board.units[BOTH], B8) && !getBit(board.units[BOTH], C8) &&
-            !getBit(board.units[BOTH], D8)) {
-            // Is d8 or e8 attacked by a white piece?
-            if (!board.sqAttacked(D8, WHITE) && !board.sqAttacked(E8, WHITE))
+        if (!(board.units[BOTH] & squaresBetween[E8][A8])) {
+            // Is c8 or d8 attacked by a white piece?
+            if (!board.sqAttacked<WHITE>(C8, board.units[BOTH]) &&
+                !board.sqAttacked<WHITE>(D8, board.units[BOTH]))
                 moveList.add(encode(E8, C8, bK, EMPTY, 0, 0, 0, 1));
         }
     }
 }
 
-bool makeMove(Board* main, const int move, MoveType moveFlag)
+// Checks if a move that didn't come from the move generator (PV or killer move) is legal in the
+// current position
+bool isLegalMove(const Board& board, const CheckInfo& info, const int move)
+{
+    if (move == 0)
+        return false;
+
+    int source = getSource(move);
+    int target = getTarget(move);
+    int piece = getPiece(move);
+    int promoted = getPromoted(move);
+    bool capture = isCapture(move);
+    bool twoSquarePush = isTwoSquarePush(move);
+    bool enpassant = isEnpassant(move);
+    Color enemy = (Color)(board.side ^ 1);
+
+    // The moving piece has to belong to the side to move and still stand on 'source'
+    if (piece >= EMPTY || board.pieceOn(source) != piece || (piece >= bP) != (board.side == BLACK))
+        return false;
+
+    // Captures have to take an enemy piece, other moves have to land on an empty square
+    if (enpassant) {
+        if (!capture || target != board.enpassant || COLORLESS(piece) != PAWN)
+            return false;
+    } else if (capture != (board.pieceOn(target) != EMPTY) ||
+               (capture && !getBit(board.units[enemy], target)))
+        return false;
+
+    if (isCastling(move)) {
+        if (COLORLESS(piece) != KING || info.checkers)
+            return false;
+        MoveList castlingMoves;
+        if (board.side == WHITE)
+            genWhiteCastling(castlingMoves, board);
+        else
+            genBlackCastling(castlingMoves, board);
+        for (int i = 0; i < castlingMoves.count; i++)
+            if (castlingMoves.list[i] == move)
+                return true;
+        return false;
+    }
+
+    if (COLORLESS(piece) != PAWN && (promoted != EMPTY || twoSquarePush || enpassant))
+        return false;
+
+    if (COLORLESS(piece) == KING) {
+        uint64_t occupancy = board.units[BOTH] & ~board.pieces[piece];
+        return getBit(kingAttacks[source], target) &&
+               !board.sqAttacked((Sq)target, enemy, occupancy);
+    }
+
+    // In double check, only king moves are legal
+    if (!info.checkMask)
+        return false;
+
+    uint64_t attacks;
+    switch (COLORLESS(piece)) {
+    case PAWN: {
+        int direction = board.side == WHITE ? SOUTH : NORTH;
+        int lastRow = board.side == WHITE ? 0 : 7;
+        int startRow = board.side == WHITE ? 6 : 1;
+        // Promotions have to promote to a knight, bishop, rook or queen of the same color
+        if ((ROW(target) == lastRow) != (promoted != EMPTY))
+            return false;
+        if (promoted != EMPTY && (COLORLESS(promoted) == PAWN || COLORLESS(promoted) == KING ||
+                                  (promoted >= bP) != (piece >= bP)))
+            return false;
+
+        if (enpassant)
+            return getBit(pawnAttacks[board.side][source], target) &&
+                   (board.side == WHITE ? isEnpassantLegal<WHITE>(board, info, source, target)
+                                        : isEnpassantLegal<BLACK>(board, info, source, target));
+        if (capture)
+            attacks = pawnAttacks[board.side][source];
+        else if (twoSquarePush)
+            attacks = (ROW(source) == startRow && board.pieceOn(source + direction) == EMPTY)
+                          ? 1ULL << (source + 2 * direction)
+                          : 0ULL;
+        else
+            attacks = 1ULL << (source + direction);
+        break;
+    }
+    case KNIGHT:
+        attacks = knightAttacks[source];
+        break;
+    case BISHOP:
+        attacks = getBishopAttack(source, board.units[BOTH]);
+        break;
+    case ROOK:
+        attacks = getRookAttack(source, board.units[BOTH]);
+        break;
+    default:
+        attacks = getQueenAttack(source, board.units[BOTH]);
+        break;
+    }
+    return getBit(attacks & legalTargets(info, source), target);
+}
+
+#ifdef _DEBUG
+// Checks the incrementally updated occupancies against a full recompute
+static void verifyUnits(const Board& board, const int move)
+{
+    Board recomputed = board;
+    recomputed.updateUnits();
+    for (int color = WHITE; color <= BOTH; color++)
+        _MY_ASSERT(board.units[color] == recomputed.units[color],
+                   "Occupancy out of sync after " + moveToStr(move));
+}
+#endif
+
+// Returns the rook type and squares involved in a castling move to 'target'
+static void getCastlingRook(const int target, int& rookType, int& castlingSource,
+                            int& castlingTarget)
+{
+    switch (target) {
+    case G1:
+        rookType = wR;
+        castlingSource = H1;
+        castlingTarget = F1;
+        break;
+    case C1:
+        rookType = wR;
+        castlingSource = A1;
+        castlingTarget = D1;
+        break;
+    case G8:
+        rookType = bR;
+        castlingSource = H8;
+        castlingTarget = F8;
+        break;
+    case C8:
+        rookType = bR;
+        castlingSource = A8;
+        castlingTarget = D8;
+        break;
+    default:
+        _MY_ASSERT(false, "Unreachable!");
+        break;
+    }
+}
+
+bool makeMove(Board* main, const int move, MoveType moveFlag, Undo& undo)
 {
     if (moveFlag == AllMoves) {
-        Board clone = *main;
+#if COPY_MAKE
+        undo.board = *main;
+#else
+        // Save the irreversible parts of the position
+        undo.captured = EMPTY;
+        undo.castling = main->castling;
+        undo.enpassant = main->enpassant;
+        undo.halfMoves = main->halfMoves;
+        undo.key = main->key;
+        undo.lock = main->lock;
+#endif
 
         // Parse move information
         int source = getSource(move);
@@ -377,6 +653,19 @@ bool makeMove(Board* main, const int move, MoveType moveFlag)
         bool enpassant = isEnpassant(move);
         bool castling = isCastling(move);
 
+        Color opponent = (Color)(main->side ^ 1);
+
+        // If capture, remove piece of opponent bitboard
+        if (capture && !enpassant) {
+            int capturedPiece = main->pieceOn(target);
+            popBit(main->pieces[capturedPiece], target);
+            updateZobristPiece(*main, capturedPiece, target);
+            main->units[opponent] ^= 1ULL << target;
+#if !COPY_MAKE
+            undo.captured = capturedPiece;
+#endif
+        }
+
         // Remove piece from 'source' and place on 'target'
         popBit(main->pieces[piece], source);
         updateZobristPiece(*main, piece, source);
@@ -384,17 +673,9 @@ bool makeMove(Board* main, const int move, MoveType moveFlag)
         setBit(main->pieces[piece], target);
         updateZobristPiece(*main, piece, target);
 
-        // If capture, remove piece of opponent bitboard
-        if (capture) {
-            for (int bbPiece = (main->side == WHITE ? bP : wP);
-                 bbPiece <= (main->side == WHITE ? bK : wK); bbPiece++) {
-                if (getBit(main->pieces[bbPiece], target)) {
-                    popBit(main->pieces[bbPiece], target);
-                    updateZobristPiece(*main, bbPiece, target);
-                    break;
-                }
-            }
-        }
+        main->setPieceOn(source, EMPTY);
+        main->setPieceOn(target, piece);
+        main->units[main->side] ^= (1ULL << source) | (1ULL << target);
 
         // Promotion move
         if (promoted != EMPTY) {
@@ -404,6 +685,8 @@ bool makeMove(Board* main, const int move, MoveType moveFlag)
 
             setBit(main->pieces[promoted], target);
             updateZobristPiece(*main, promoted, target);
+
+            main->setPieceOn(target, promoted);
         }
 
         // Enpassant capture
@@ -419,6 +702,11 @@ bool makeMove(Board* main, const int move, MoveType moveFlag)
             }
             popBit(main->pieces[pawnType], target + dir);
             updateZobristPiece(*main, pawnType, target + dir);
+            main->setPieceOn(target + dir, EMPTY);
+            main->units[opponent] ^= 1ULL << (target + dir);
+#if !COPY_MAKE
+            undo.captured = pawnType;
+#endif
         }
 
         if (main->enpassant != NOSQ)
@@ -438,36 +726,17 @@ bool makeMove(Board* main, const int move, MoveType moveFlag)
         // Castling
         if (castling) {
             int rookType, castlingSource, castlingTarget;
-            switch (target) {
-            case G1:
-                rookType = wR;
-                castlingSource = H1;
-                castlingTarget = F1;
-                break;
-            case C1:
-                rookType = wR;
-                castlingSource = A1;
-                castlingTarget = D1;
-                break;
-            case G8:
-                rookType = bR;
-                castlingSource = H8;
-                castlingTarget = F8;
-                break;
-            case C8:
-                rookType = bR;
-                castlingSource = A8;
-                castlingTarget = D8;
-                break;
-            default:
-                _MY_ASSERT(false, "Unreachable!");
-                break;
-            }
+            getCastlingRook(target, rookType, castlingSource, castlingTarget);
+
             popBit(main->pieces[rookType], castlingSource);
             updateZobristPiece(*main, rookType, castlingSource);
 
             setBit(main->pieces[rookType], castlingTarget);
             updateZobristPiece(*main, rookType, castlingTarget);
+
+            main->setPieceOn(castlingSource, EMPTY);
+            main->setPieceOn(castlingTarget, rookType);
+            main->units[main->side] ^= (1ULL << castlingSource) | (1ULL << castlingTarget);
         }
 
         // Update castling rights
@@ -476,8 +745,17 @@ bool makeMove(Board* main, const int move, MoveType moveFlag)
         main->castling &= CASTLING_RIGHTS[target];
         updateZobristCastling(*main);
 
-        // Update units (or occupancies)
-        main->updateUnits();
+        // Reset the fifty move counter on pawn moves and captures
+        if (capture || COLORLESS(piece) == PAWN)
+            main->halfMoves = 0;
+        else
+            main->halfMoves++;
+
+        // Update occupancy of both sides
+        main->units[BOTH] = main->units[WHITE] | main->units[BLACK];
+#ifdef _DEBUG
+        verifyUnits(*main, move);
+#endif
 
         // Change side
         main->changeSide();
@@ -502,20 +780,107 @@ bool makeMove(Board* main, const int move, MoveType moveFlag)
         }
         ============= FOR DEBUG PURPOSES ONLY =============== */
 
-        // Check if king is in check
-        if (main->inCheck()) {
-            // Restore board and return false
-            *main = clone;
-            return false;
-        } else {
-            // Move is legal and was made, return true
-            return true;
-        }
+        // Moves are generated fully legal, so there's no need to test for a check here
+        return true;
     } else {
         // If capture, recall makeMove() and make move
         if (isCapture(move))
-            return makeMove(main, move, AllMoves);
+            return makeMove(main, move, AllMoves, undo);
         // If not capture, don't make move
         return false;
     }
-}
\ No newline at end of file
+}
+
+void unmakeMove(Board* main, const int move, const Undo& undo)
+{
+#if COPY_MAKE
+    (void)move;
+    *main = undo.board;
+#else
+    // Parse move information
+    int source = getSource(move);
+    int target = getTarget(move);
+    int piece = getPiece(move);
+    int promoted = getPromoted(move);
+
+    // Give the turn back to the side that made the move
+    main->changeSide();
+
+    // Move piece from 'target' back to 'source'
+    popBit(main->pieces[promoted != EMPTY ? promoted : piece], target);
+    setBit(main->pieces[piece], source);
+    main->setPieceOn(target, EMPTY);
+    main->setPieceOn(source, piece);
+    main->units[main->side] ^= (1ULL << source) | (1ULL << target);
+
+    // Put captured piece back on its square
+    if (undo.captured != EMPTY) {
+        int captureSq = target;
+        if (isEnpassant(move))
+            captureSq += (main->side == WHITE) ? NORTH : SOUTH;
+        setBit(main->pieces[undo.captured], captureSq);
+        main->setPieceOn(captureSq, undo.captured);
+        main->units[main->side ^ 1] ^= 1ULL << captureSq;
+    }
+
+    // Move castling rook back to its corner
+    if (isCastling(move)) {
+        int rookType, castlingSource, castlingTarget;
+        getCastlingRook(target, rookType, castlingSource, castlingTarget);
+        popBit(main->pieces[rookType], castlingTarget);
+        setBit(main->pieces[rookType], castlingSource);
+        main->setPieceOn(castlingTarget, EMPTY);
+        main->setPieceOn(castlingSource, rookType);
+        main->units[main->side] ^= (1ULL << castlingSource) | (1ULL << castlingTarget);
+    }
+
+    // Restore irreversible state
+    main->castling = undo.castling;
+    main->enpassant = undo.enpassant;
+    main->halfMoves = undo.halfMoves;
+    main->key = undo.key;
+    main->lock = undo.lock;
+
+    main->units[BOTH] = main->units[WHITE] | main->units[BLACK];
+#ifdef _DEBUG
+    verifyUnits(*main, move);
+#endif
+#endif
+}
+
+void makeNullMove(Board* main, Undo& undo)
+{
+#if COPY_MAKE
+    undo.board = *main;
+#else
+    undo.captured = EMPTY;
+    undo.castling = main->castling;
+    undo.enpassant = main->enpassant;
+    undo.halfMoves = main->halfMoves;
+    undo.key = main->key;
+    undo.lock = main->lock;
+#endif
+
+    // Hash enpassant if available
+    if (main->enpassant != NOSQ)
+        updateZobristEnpassant(*main);
+    // Reset enpassant
+    main->enpassant = NOSQ;
+
+    // Give opponent an extra move; 2 moves in one turn
+    main->changeSide();
+    // Hash the extra turn given by hashing the side one more time
+    updateZobristSide(*main);
+}
+
+void unmakeNullMove(Board* main, const Undo& undo)
+{
+#if COPY_MAKE
+    *main = undo.board;
+#else
+    main->changeSide();
+    main->enpassant = undo.enpassant;
+    main->key = undo.key;
+    main->lock = undo.lock;
+#endif
+}
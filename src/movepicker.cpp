@@ -0,0 +1,176 @@
+#include "defs.hpp"
+
+// clang-format off
+// [attacker][victim]
+const int mvvLva[6][6] =
+{
+	{105, 205, 305, 405, 505, 605},
+	{104, 204, 304, 404, 504, 604},
+	{103, 203, 303, 403, 503, 603},
+	{102, 202, 302, 402, 502, 602},
+	{101, 201, 301, 401, 501, 601},
+	{100, 200, 300, 400, 500, 600}
+};
+// clang-format on
+
+/*
+        Move Picking Order or Priority
+          1. PV or hash move (before any move is generated)
+          2. Good captures   (MVV LVA, SEE >= 0)
+          3. 1st killer move
+          4. 2nd killer move
+          5. Quiet moves     (history)
+          6. Bad captures    (SEE < 0, never tried in quiescence)
+*/
+static int scoreMove(const Board& board, const SearchTable& sTable, const int move)
+{
+    // Capture move scoring
+    if (isCapture(move)) {
+        // Enpassant captures land on an empty square, but always take a pawn
+        int victimPiece = isEnpassant(move) ? (int)wP : board.pieceOn(getTarget(move));
+        return mvvLva[getPiece(move) % 6][victimPiece % 6] + 10'000;
+    }
+    // Quiet move scoring
+    else
+        return sTable.historyMoves[getPiece(move)][getTarget(move)];
+}
+
+static void scoreMoves(MoveList& moveList, const Board& board, const SearchTable& sTable)
+{
+    for (int i = 0; i < moveList.count; i++)
+        moveList.list[i].score = scoreMove(board, sTable, moveList.list[i].move);
+}
+
+// Taking a piece that is worth at least as much as the attacker can't lose material, so SEE is
+// only needed for the other captures
+static bool isGoodCapture(const Board& board, const int move)
+{
+    if (getPromoted(move) != EMPTY || isEnpassant(move))
+        return true;
+    if (SEE_VALUES[COLORLESS(board.pieceOn(getTarget(move)))] >=
+        SEE_VALUES[COLORLESS(getPiece(move))])
+        return true;
+    return board.see(move) >= 0;
+}
+
+// Swaps the best scored move out of list[current..count) to list[current], so that moves are
+// only ordered as far as the search actually asks for them
+static void pickBest(MoveList& moveList, const int current)
+{
+    int best = current;
+    for (int next = current + 1; next < moveList.count; next++)
+        if (moveList.list[next].score > moveList.list[best].score)
+            best = next;
+
+    ExtMove temp = moveList.list[current];
+    moveList.list[current] = moveList.list[best];
+    moveList.list[best] = temp;
+}
+
+// Sorts the moves scoring at least 'limit' to the front of the list, best first, and leaves the
+// rest unordered behind them
+static void partialInsertionSort(MoveList& moveList, const int limit)
+{
+    int sortedEnd = 0;
+    for (int next = 0; next < moveList.count; next++) {
+        if (moveList.list[next].score < limit)
+            continue;
+        ExtMove temp = moveList.list[next];
+        moveList.list[next] = moveList.list[sortedEnd];
+        int curr = sortedEnd++;
+        for (; curr > 0 && moveList.list[curr - 1].score < temp.score; curr--)
+            moveList.list[curr] = moveList.list[curr - 1];
+        moveList.list[curr] = temp;
+    }
+}
+
+MovePicker::MovePicker(const Board& board, const CheckInfo& info, const SearchTable& sTable,
+                       const int pvMove, MoveType moveType)
+    : board(board), info(info), sTable(sTable), moveType(moveType), stage(PICK_PV),
+      pvMove(pvMove), current(0)
+{
+    badCaptures.count = 0;
+    killers[0] = unpackMove(sTable.killerMoves[0][sTable.ply], board);
+    killers[1] = unpackMove(sTable.killerMoves[1][sTable.ply], board);
+}
+
+int MovePicker::next()
+{
+    int move;
+    switch (stage) {
+    case PICK_PV:
+        stage = PICK_GEN_CAPTURES;
+        if (pvMove && (moveType != OnlyCaptures || isCapture(pvMove)) &&
+            isLegalMove(board, info, pvMove))
+            return pvMove;
+        // The PV move isn't playable here, so don't skip it in the later stages
+        pvMove = 0;
+        [[fallthrough]];
+
+    case PICK_GEN_CAPTURES:
+        generate(moveList, board, OnlyCaptures, info);
+        scoreMoves(moveList, board, sTable);
+        current = 0;
+        stage = PICK_GOOD_CAPTURES;
+        [[fallthrough]];
+
+    case PICK_GOOD_CAPTURES:
+        while (current < moveList.count) {
+            pickBest(moveList, current);
+            move = moveList.list[current++].move;
+            if (move == pvMove)
+                continue;
+            if (isGoodCapture(board, move))
+                return move;
+            badCaptures.add(move);
+        }
+        if (moveType == OnlyCaptures) {
+            stage = PICK_DONE;
+            return 0;
+        }
+        current = 0;
+        stage = PICK_KILLERS;
+        [[fallthrough]];
+
+    case PICK_KILLERS:
+        while (current < 2) {
+            move = killers[current++];
+            // Both killer slots can hold the same move after repeated cutoffs
+            if (move == pvMove || (current == 2 && move == killers[0]))
+                continue;
+            if (!isCapture(move) && isLegalMove(board, info, move))
+                return move;
+        }
+        stage = PICK_GEN_QUIETS;
+        [[fallthrough]];
+
+    case PICK_GEN_QUIETS:
+        generate(moveList, board, OnlyQuiets, info);
+        scoreMoves(moveList, board, sTable);
+        // Most quiet moves have no history score, only the ones that do need ordering
+        partialInsertionSort(moveList, 1);
+        current = 0;
+        stage = PICK_QUIETS;
+        [[fallthrough]];
+
+    case PICK_QUIETS:
+        while (current < moveList.count) {
+            move = moveList.list[current++].move;
+            if (move != pvMove && move != killers[0] && move != killers[1])
+                return move;
+        }
+        current = 0;
+        stage = PICK_BAD_CAPTURES;
+        [[fallthrough]];
+
+    case PICK_BAD_CAPTURES:
+        // Already in MVV LVA order
+        if (current < badCaptures.count)
+            return badCaptures.list[current++].move;
+        stage = PICK_DONE;
+        [[fallthrough]];
+
+    default:
+        return 0;
+    }
+}
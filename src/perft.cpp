@@ -8,18 +8,16 @@ void driver(Board& board, int depth, uint64_t& nodeCount, MoveType moveType)
     }
     MoveList moveList;
     genAllMoves(moveList, board);
-    Board clone;
+    Undo undo;
     for (int i = 0; i < moveList.count; i++) {
-        // Clone the current state of the board
-        clone = board;
-        // Make move if it's not illegal (or check)
-        if (!makeMove(&board, moveList.list[i], moveType))
+        // Make move (quiet moves are skipped when only counting captures)
+        if (!makeMove(&board, moveList.list[i], moveType, undo))
             continue;
 
         driver(board, depth - 1, nodeCount, moveType);
 
         // Restore board state
-        board = clone;
+        unmakeMove(&board, moveList.list[i], undo);
         /* ============= FOR DEBUG PURPOSES ONLY ===============
         uint64_t generatedKey = genKey(board);
         uint64_t generatedLock = genLock(board);
@@ -49,19 +47,17 @@ uint64_t perftTest(Board& board, const int depth, MoveType moveType)
 		genAllMoves(moveList, board);
     else
 		genCaptureMoves(moveList, board);
-    Board clone;
+    Undo undo;
     for (int i = 0; i < moveList.count; i++) {
-        // Clone the current state of the board
-        clone = board;
-        // Make move if it's not illegal (or check)
-        if (!makeMove(&board, moveList.list[i], moveType))
+        // Make move (quiet moves are skipped when only counting captures)
+        if (!makeMove(&board, moveList.list[i], moveType, undo))
             continue;
 
         uint64_t prevNodeCount = nodeCount;
         driver(board, depth - 1, nodeCount, moveType);
 
         // Restore board state
-        board = clone;
+        unmakeMove(&board, moveList.list[i], undo);
 
         if (sInfo.debugMode) {
             std::cout << moveToStr(moveList.list[i]) << ": " << (nodeCount - prevNodeCount)
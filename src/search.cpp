@@ -12,112 +12,21 @@ const int MATE_SCORE = 48'000;
 const int FULL_DEPTH_MOVES = 4;
 const int REDUCTION_LIMIT = 3;
 
-// clang-format off
-// [attacker][victim]
-const int mvvLva[6][6] =
-{
-	{105, 205, 305, 405, 505, 605},
-	{104, 204, 304, 404, 504, 604},
-	{103, 203, 303, 403, 503, 603},
-	{102, 202, 302, 402, 502, 602},
-	{101, 201, 301, 401, 501, 601},
-	{100, 200, 300, 400, 500, 600}
-};
-// clang-format on
-
 SearchTable mainSearchTable;
 
-/*
-        Move Scoring Order or Priority
-          1. PV moves        ( = 20,000 pts)
-          2. MVV LVA move    (>= 10,000 pts)
-          3. 1st killer move ( =  9,000 pts)
-          4. 2nd killer move ( =  8,000 pts)
-          5. History move
-          6. Unsorted move
-*/
-static int scoreMoves(const Board& board, SearchTable& sTable, const int move)
-{
-    // PV (Principal variation move) scoring
-    if (sTable.scorePV && sTable.pvTable[0][sTable.ply] == move) {
-        sTable.scorePV = false;
-        return 20'000;
-    }
-    // Capture move scoring
-    if (isCapture(move)) {
-        int victimPiece = wP;
-        for (int bbPiece = (board.side == WHITE ? bP : wP);
-             bbPiece <= (board.side == WHITE ? bK : wK); bbPiece++) {
-            if (getBit(board.pieces[bbPiece], getTarget(move))) {
-                victimPiece = bbPiece;
-                break;
-            }
-        }
-        return mvvLva[getPiece(move) % 6][victimPiece % 6] + 10'000;
-    }
-    // Quiet move scoring
-    else {
-        // Score 1st killer move
-        if (sTable.killerMoves[0][sTable.ply] == move)
-            return 9'000;
-        // Score 2nd killer move
-        else if (sTable.killerMoves[1][sTable.ply] == move)
-            return 8'000;
-        // Score history moves
-        else
-            return sTable.historyMoves[getPiece(move)][getTarget(move)];
-    }
-}
-
-static void printMoveScores(const MoveList& moveList, const Board& board, SearchTable& sTable)
-{
-    std::cout << "Move scores: \n";
-    for (int i = 0; i < moveList.count; i++)
-        std::cout << "    " << moveToStr(moveList.list[i]).c_str() << ": "
-                  << scoreMoves(board, sTable, moveList.list[i]) << "\n";
-}
-
-static void enablePVScoring(MoveList& moveList, SearchTable& sTable)
+// Returns the move of the previous iteration's principal variation at this ply, as long as the
+// search is still following it and the move is legal here
+static int getPVMove(const Board& board, const CheckInfo& info, SearchTable& sTable)
 {
-    sTable.followPV = false;
-    for (int i = 0; i < moveList.count; i++) {
-        if (sTable.pvTable[0][sTable.ply] == moveList.list[i]) {
-            // Enable PV scoring and following
-            sTable.scorePV = true;
-            sTable.followPV = true;
-        }
-    }
+    int pvMove = unpackMove(sTable.pvTable[0][sTable.ply], board);
+    sTable.followPV = isLegalMove(board, info, pvMove);
+    return sTable.followPV ? pvMove : 0;
 }
 
-static void sortMoves(MoveList& moveList, const Board& board, SearchTable& sTable)
+static bool isRepetition(const Board& board, const SearchTable& sTable)
 {
-    int* moveScores = new int[moveList.count];
-    // Initialize moveScores with move scores
-    for (int i = 0; i < moveList.count; i++)
-        moveScores[i] = scoreMoves(board, sTable, moveList.list[i]);
-
-    // Sort moves based on scores
-    for (int curr = 0; curr < moveList.count; curr++) {
-        for (int next = curr + 1; next < moveList.count; next++) {
-            if (moveScores[curr] < moveScores[next]) {
-                // Swap moves
-                int temp = moveList.list[curr];
-                moveList.list[curr] = moveList.list[next];
-                moveList.list[next] = temp;
-                // Swap scores
-                temp = moveScores[curr];
-                moveScores[curr] = moveScores[next];
-                moveScores[next] = temp;
-            }
-        }
-    }
-    delete[] moveScores;
-}
-
-static bool isRepetition(Board& board)
-{
-    for (int i = 0; i < board.repetitionIndex; i++) {
-        if (board.repetitionTable[i] == board.key) {
+    for (int i = 0; i < sTable.repetitionIndex; i++) {
+        if (sTable.repetitionTable[i] == board.key) {
             return true;
         }
     }
@@ -129,7 +38,6 @@ static void clearSearchTable(HashTable* tt, SearchInfo* sInfo, SearchTable* sTab
     sTable->nodes = 0LL;
     sInfo->stop = false;
     sTable->followPV = false;
-    sTable->scorePV = false;
     memset(sTable->killerMoves, 0, sizeof(sTable->killerMoves));
     memset(sTable->historyMoves, 0, sizeof(sTable->historyMoves));
     memset(sTable->pvTable, 0, sizeof(sTable->pvTable));
@@ -165,28 +73,25 @@ static int quiescence(Board* board, SearchInfo* sInfo, SearchTable* sTable, int
         // Principal Variation (PV) node
         alpha = evaluation;
 
-    // Generate and sort moves
-    MoveList moveList;
-    genCaptureMoves(moveList, *board);
-    sortMoves(moveList, *board, *sTable);
-
-    Board clone;
-    // Loop over all the generated moves
-    for (int i = 0; i < moveList.count; i++) {
-        // Bookmark current of board
-        clone = *board;
+    CheckInfo info;
+    genCheckInfo(info, *board);
+    MovePicker picker(*board, info, *sTable, 0, OnlyCaptures);
 
+    Undo undo;
+    int mv;
+    // Loop over the captures, best first
+    while ((mv = picker.next()) != 0) {
         // Increment half move
         sTable->ply++;
 
-        board->repetitionIndex++;
-        board->repetitionTable[board->repetitionIndex] = board->key;
+        sTable->repetitionIndex++;
+        sTable->repetitionTable[sTable->repetitionIndex] = board->key;
 
-        // Play move if move is legal
-        if (!makeMove(board, moveList.list[i], MoveType::OnlyCaptures)) {
+        // Play move if it's a capture
+        if (!makeMove(board, mv, MoveType::OnlyCaptures, undo)) {
             // Decrement move and move onto next move
             sTable->ply--;
-            board->repetitionIndex--;
+            sTable->repetitionIndex--;
             continue;
         }
 
@@ -195,9 +100,9 @@ static int quiescence(Board* board, SearchInfo* sInfo, SearchTable* sTable, int
 
         // Decrement ply and restore board state
         sTable->ply--;
-        board->repetitionIndex--;
+        sTable->repetitionIndex--;
 
-        *board = clone;
+        unmakeMove(board, mv, undo);
 
         if (sInfo->stop)
             return 0;
@@ -223,7 +128,7 @@ static int negamax(Board* board, HashTable* tt, SearchInfo* sInfo, SearchTable*
     TTFlag flag = F_ALPHA;
 
     // if position repetition occurs
-    if (sTable->ply && isRepetition(*board)) {
+    if (sTable->ply && isRepetition(*board, *sTable)) {
         // return draw score
         return 0;
     }
@@ -231,9 +136,10 @@ static int negamax(Board* board, HashTable* tt, SearchInfo* sInfo, SearchTable*
     bool isPVNode = (beta - alpha) > 1;
 
     // Read score from transposition table if position already exists inside the
-    // table
-    if (sTable->ply && (score = tt->read(*board, *sTable, alpha, beta, depth)) != NO_TT_ENTRY &&
-        !isPVNode)
+    // table, its best move is searched first even when the score can't be used
+    int hashMove;
+    if ((score = tt->read(*board, *sTable, alpha, beta, depth, hashMove)) != NO_TT_ENTRY &&
+        sTable->ply && !isPVNode)
         return score;
 
     // every 2047 nodes
@@ -253,9 +159,9 @@ static int negamax(Board* board, HashTable* tt, SearchInfo* sInfo, SearchTable*
     sTable->nodes++;
 
     // Is the king in check?
-    // bool inCheck = board->inCheck();
-    bool inCheck = board->sqAttacked((Sq)lsbIndex(board->pieces[board->side == WHITE ? wK : bK]),
-                                     (Color)(board->side ^ 1));
+    CheckInfo info;
+    genCheckInfo(info, *board);
+    bool inCheck = info.checkers != 0;
 
     // Check extension
     if (inCheck) {
@@ -266,30 +172,23 @@ static int negamax(Board* board, HashTable* tt, SearchInfo* sInfo, SearchTable*
 
     // NULL move pruning
     if (depth >= 3 && !inCheck && sTable->ply) {
-        Board anotherClone = *board;
+        Undo nullUndo;
         sTable->ply++;
 
-        board->repetitionIndex++;
-        board->repetitionTable[board->repetitionIndex] = board->key;
-
-        // Hash enpassant if available
-        if (board->enpassant != NOSQ)
-            updateZobristEnpassant(*board);
-        // Reset enpassant
-        board->enpassant = NOSQ;
+        sTable->repetitionIndex++;
+        sTable->repetitionTable[sTable->repetitionIndex] = board->key;
 
         // Give opponent an extra move; 2 moves in one turn
-        board->changeSide();
-        // Hash the extra turn given by hashing the side one more time
-        updateZobristSide(*board);
+        makeNullMove(board, nullUndo);
+        tt->prefetch(board->key);
 
         // Search move with reduced depth to find beta-cutoffs
         score = -negamax(board, tt, sInfo, sTable, -beta, -beta + 1, depth - 1 - 2);
 
         sTable->ply--;
-        board->repetitionIndex--;
+        sTable->repetitionIndex--;
 
-        *board = anotherClone;
+        unmakeNullMove(board, nullUndo);
         if (sInfo->stop)
             return 0;
         // Fail hard; beta-cutoffs
@@ -297,34 +196,27 @@ static int negamax(Board* board, HashTable* tt, SearchInfo* sInfo, SearchTable*
             return beta;
     }
 
-    // Generate and sort moves
-    MoveList moveList;
-    genAllMoves(moveList, *board);
-    if (sTable->followPV)
-        enablePVScoring(moveList, *sTable);
-    sortMoves(moveList, *board, *sTable);
-
-    Board clone;
-    int movesSearched = 0;
-    // Loop over all the generated moves
-    for (int i = 0; i < moveList.count; i++) {
-        int mv = moveList.list[i];
-        // Bookmark current of board
-        clone = *board;
+    // Moves are generated stage by stage, so a cutoff skips generating the rest. The PV move comes
+    // first while following the PV, the hash move otherwise
+    int pvMove = sTable->followPV ? getPVMove(*board, info, *sTable) : 0;
+    MovePicker picker(*board, info, *sTable, pvMove ? pvMove : hashMove, AllMoves);
+
+    Undo undo;
+    int mv, bestMove = 0, movesSearched = 0;
+    // Loop over the moves, best first
+    while ((mv = picker.next()) != 0) {
+
+        // Play move; the move generator only produces legal moves
+        uint64_t parentKey = board->key;
+        makeMove(board, mv, MoveType::AllMoves, undo);
+        // The child probes the table first thing, its bucket loads during the bookkeeping below
+        tt->prefetch(board->key);
 
         // Increment half move
         sTable->ply++;
 
-        board->repetitionIndex++;
-        board->repetitionTable[board->repetitionIndex] = board->key;
-
-        // Play move if move is legal
-        if (!makeMove(board, mv, MoveType::AllMoves)) {
-            // Decrement move and move onto next move
-            sTable->ply--;
-            board->repetitionIndex--;
-            continue;
-        }
+        sTable->repetitionIndex++;
+        sTable->repetitionTable[sTable->repetitionIndex] = parentKey;
 
         // Increment legal moves
         legalMoves++;
@@ -354,9 +246,9 @@ static int negamax(Board* board, HashTable* tt, SearchInfo* sInfo, SearchTable*
         }
         // Decrement ply and restore board state
         sTable->ply--;
-        board->repetitionIndex--;
+        sTable->repetitionIndex--;
 
-        *board = clone;
+        unmakeMove(board, mv, undo);
 
         if (sInfo->stop)
             return 0;
@@ -373,8 +265,9 @@ static int negamax(Board* board, HashTable* tt, SearchInfo* sInfo, SearchTable*
 
             // Principal Variation (PV) node
             alpha = score;
+            bestMove = mv;
             // Write PV move
-            sTable->pvTable[sTable->ply][sTable->ply] = mv;
+            sTable->pvTable[sTable->ply][sTable->ply] = packMove(mv);
             // Copy move from deeper ply into current ply
             for (int next = sTable->ply + 1; next < sTable->pvLength[sTable->ply + 1]; next++) {
                 sTable->pvTable[sTable->ply][next] = sTable->pvTable[sTable->ply + 1][next];
@@ -385,13 +278,13 @@ static int negamax(Board* board, HashTable* tt, SearchInfo* sInfo, SearchTable*
             // Fail-hard beta cutoff
             if (score >= beta) {
                 // Store hash entry with score equal to beta
-                tt->store(*board, *sTable, beta, depth, F_BETA);
+                tt->store(*board, *sTable, beta, depth, F_BETA, mv);
 
                 if (!isCapture(mv)) {
                     // Move 1st killer move to 2nd killer move
                     sTable->killerMoves[1][sTable->ply] = sTable->killerMoves[0][sTable->ply];
                     // Update 1st killer move to current move
-                    sTable->killerMoves[0][sTable->ply] = mv;
+                    sTable->killerMoves[0][sTable->ply] = packMove(mv);
                 }
                 // Move that fails high
                 return beta;
@@ -410,7 +303,7 @@ static int negamax(Board* board, HashTable* tt, SearchInfo* sInfo, SearchTable*
         }
     }
     // Store hash entry with score equal to alpha
-    tt->store(*board, *sTable, alpha, depth, flag);
+    tt->store(*board, *sTable, alpha, depth, flag, bestMove);
     // Move that failed low
     return alpha;
 }
@@ -455,7 +348,7 @@ void workerSearchPos(SearchWorkerData* data)
                 std::cout << " depth " << currDepth << " nodes " << data->sTable->nodes << " time "
                           << (getCurrTime() - data->sInfo->startTime) << " pv";
                 for (int i = 0; i < data->sTable->pvLength[0]; i++)
-                    std::cout << " " << moveToStr(data->sTable->pvTable[0][i]);
+                    std::cout << " " << packedMoveToStr(data->sTable->pvTable[0][i]);
                 std::cout << "\n";
             }
         }
@@ -472,6 +365,8 @@ void searchPos(Board* board, HashTable* tt, SearchInfo* sInfo, SearchTable* sTab
         }
     }
 
+    // Entries from earlier searches become the first to be replaced
+    tt->currentAge++;
     createSearchWorkers(board, sInfo, sTable, tt);
     //std::cout << "Created " << sInfo->threadCount << " thread(s)...\n";
 
@@ -67,4 +67,224 @@ void polyKeyGeneration()
     }
 }
 
+void perft()
+{
+    // Positions with pins, discovered checks and tricky enpassant captures
+    const std::string FEN_LIST[8] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1",
+        "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1",
+        "5k2/8/8/8/8/8/8/4K2R w K - 0 1",
+        "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1",
+    };
+    const int DEPTH_LIST[8] = {4, 5, 4, 4, 6, 6, 6, 5};
+    const uint64_t NODE_LIST[8] = {
+        4085603, 674624, 422333, 2103487, 1134888, 1440467, 661072, 1004658,
+    };
+
+    Board b;
+    for (int i = 0; i < 8; i++) {
+        b.parseFen(FEN_LIST[i]);
+        uint64_t nodes = perftTest(b, DEPTH_LIST[i], AllMoves);
+        _MY_ASSERT(nodes == NODE_LIST[i], format_fail_str(STR(nodes), STR(NODE_LIST[i])));
+    }
+    print_completion("perft");
+}
+
+void staticExchange()
+{
+    const std::string FEN_LIST[5] = {
+        "1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1",
+        "1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1",
+        "4k3/8/8/3p4/4P3/8/8/4K3 w - - 0 1",
+        "4k3/2n5/8/3p4/4P3/8/8/4K3 w - - 0 1",
+        "4k3/2p5/8/3pP3/8/8/8/4K3 w - d6 0 1",
+    };
+    const std::string MOVE_LIST[5] = {"e1e5", "d3e5", "e4d5", "e4d5", "e5d6"};
+    const int SEE_LIST[5] = {100, -200, 100, 0, 0};
+
+    Board b;
+    for (int i = 0; i < 5; i++) {
+        b.parseFen(FEN_LIST[i]);
+        int move = parseMoveStr(MOVE_LIST[i], b);
+        _MY_ASSERT(move != 0, "Illegal move " + MOVE_LIST[i]);
+        int value = b.see(move);
+        _MY_ASSERT(value == SEE_LIST[i], MOVE_LIST[i] + " has a SEE of " + STR(value) +
+                                             " instead of " + STR(SEE_LIST[i]));
+    }
+    print_completion("static_exchange");
+}
+
+void legalMoveCheck()
+{
+    const std::string FEN_LIST[6] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1",
+        "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1",
+    };
+
+    // The listed positions and every position one ply away from them
+    Board positions[6 * 64];
+    int positionCount = 0;
+    for (int i = 0; i < 6; i++) {
+        Board b;
+        b.parseFen(FEN_LIST[i]);
+        positions[positionCount++] = b;
+
+        MoveList moveList;
+        genAllMoves(moveList, b);
+        _MY_ASSERT(moveList.count < 64, "Too many moves in " + FEN_LIST[i]);
+        for (int j = 0; j < moveList.count; j++) {
+            Undo undo;
+            makeMove(&b, moveList.list[j], AllMoves, undo);
+            positions[positionCount++] = b;
+            unmakeMove(&b, moveList.list[j], undo);
+        }
+    }
+
+    for (int i = 0; i < positionCount; i++) {
+        MoveList legal;
+        genAllMoves(legal, positions[i]);
+        CheckInfo info;
+        genCheckInfo(info, positions[i]);
+
+        // Packed moves have to unpack to the exact generated move
+        for (int k = 0; k < legal.count; k++)
+            _MY_ASSERT(unpackMove(packMove(legal.list[k]), positions[i]) == legal.list[k],
+                       "Packed move " + moveToStr(legal.list[k]) + " doesn't round trip");
+
+        // Try the moves of nearby positions: the parent, siblings and children
+        for (int j = std::max(0, i - 32); j < std::min(positionCount, i + 32); j++) {
+            MoveList candidates;
+            genAllMoves(candidates, positions[j]);
+            for (int k = 0; k < candidates.count; k++) {
+                int move = candidates.list[k];
+                bool expected = false;
+                for (int l = 0; l < legal.count; l++)
+                    expected |= legal.list[l] == move;
+                _MY_ASSERT(isLegalMove(positions[i], info, move) == expected,
+                           moveToStr(move) + (expected ? " should be legal" : " should be illegal"));
+            }
+        }
+    }
+    print_completion("legal_move_check");
+}
+
+void attackMaps()
+{
+    bool startAvx2 = useAvx2Fills;
+    Board b;
+    for (int i = 1; i < 8; i++) {
+        b.parseFen(FEN_POSITIONS[i]);
+        // Both fills have to agree with looking at every square on its own
+        for (int avx2 = 0; avx2 <= (int)avx2Supported(); avx2++) {
+            useAvx2Fills = avx2;
+            uint64_t whiteMap = b.attackMap<WHITE>(b.units[BOTH]);
+            uint64_t blackMap = b.attackMap<BLACK>(b.units[BOTH]);
+            for (int sq = 0; sq < 64; sq++) {
+                _MY_ASSERT(getBit(whiteMap, sq) == b.sqAttacked<WHITE>((Sq)sq, b.units[BOTH]),
+                           "White attack map differs on " + STR_COORDS[sq] + " in " +
+                               FEN_POSITIONS[i]);
+                _MY_ASSERT(getBit(blackMap, sq) == b.sqAttacked<BLACK>((Sq)sq, b.units[BOTH]),
+                           "Black attack map differs on " + STR_COORDS[sq] + " in " +
+                               FEN_POSITIONS[i]);
+            }
+
+            // The summed mobility has to match counting every slider's attacks on its own
+            for (int offset = 0; offset <= 6; offset += 6) {
+                uint64_t rooks = b.pieces[wR + offset] | b.pieces[wQ + offset];
+                uint64_t bishops = b.pieces[wB + offset] | b.pieces[wQ + offset];
+                int expected = 0;
+                for (uint64_t bb = rooks; bb;)
+                    expected += countBits(getRookAttack(popLsb(bb), b.units[BOTH]));
+                for (uint64_t bb = bishops; bb;)
+                    expected += countBits(getBishopAttack(popLsb(bb), b.units[BOTH]));
+                _MY_ASSERT(sliderMobility(rooks, bishops, b.units[BOTH]) == expected,
+                           "Slider mobility differs in " + FEN_POSITIONS[i]);
+            }
+        }
+    }
+    useAvx2Fills = startAvx2;
+    print_completion("attack_maps");
+}
+
+void sliderAttacks()
+{
+    // The slider lookups, whichever backend they were built with, against walking the rays
+    XorShift rng;
+    for (int sq = 0; sq < 64; sq++) {
+        for (int i = 0; i < 1000; i++) {
+            uint64_t occupancy = rng.random64() & rng.random64();
+            _MY_ASSERT(getBishopAttack(sq, occupancy) == genBishopAttack(sq, occupancy),
+                       "Bishop attacks differ on " + STR_COORDS[sq]);
+            _MY_ASSERT(getRookAttack(sq, occupancy) == genRookAttack(sq, occupancy),
+                       "Rook attacks differ on " + STR_COORDS[sq]);
+        }
+    }
+    print_completion("slider_attacks");
+}
+
+void transpositionTable()
+{
+    HashTable tt;
+    tt.init(1);
+    SearchTable* sTable = new SearchTable();
+    Board b;
+    b.parseFen(FEN_POSITIONS[1]);
+    const int MOVE = parseMoveStr("e2e4", b);
+    // Buckets come from the high bits of the key, keys that differ in the low bits share one
+    const uint64_t BASE_KEY = 0x123456789ULL;
+    const int depths[6] = {5, 3, 7, 9, 4, 1};
+    auto keyOf = [&](const int i) { return BASE_KEY + (uint64_t)i; };
+    auto isStored = [&](const int i) {
+        b.key = keyOf(i);
+        int hashMove;
+        return tt.read(b, *sTable, -INF, INF, 0, hashMove) == 10 * i && hashMove == MOVE;
+    };
+
+    for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+        b.key = keyOf(i);
+        tt.store(b, *sTable, 10 * i, depths[i], F_EXACT, MOVE);
+    }
+    for (int i = 0; i < TT_BUCKET_SIZE; i++)
+        _MY_ASSERT(isStored(i), "Entry " + std::to_string(i) + " is missing from a free bucket");
+
+    // A full bucket gives up its shallowest entry
+    b.key = keyOf(4);
+    tt.store(b, *sTable, 40, depths[4], F_EXACT, MOVE);
+    _MY_ASSERT(isStored(4) && !isStored(1), "The shallowest entry wasn't replaced");
+
+    // Entries of an earlier search go before deeper ones of the current search
+    tt.currentAge++;
+    b.key = keyOf(5);
+    tt.store(b, *sTable, 50, depths[5], F_EXACT, MOVE);
+    _MY_ASSERT(isStored(5) && !isStored(4), "The least valuable old entry wasn't replaced");
+    _MY_ASSERT(isStored(0) && isStored(2) && isStored(3), "A deeper entry was replaced");
+
+    // Keys are spread over the whole table
+    _MY_ASSERT(tt.bucketOf(0ULL) == tt.table &&
+                   tt.bucketOf(~0ULL) == tt.table + tt.bucketCount - 1,
+               "The first and last keys don't map to the ends of the table");
+
+    // A fail-low has no best move and keeps the one stored before
+    b.key = keyOf(0);
+    tt.store(b, *sTable, 0, depths[0], F_ALPHA, 0);
+    int hashMove;
+    tt.read(b, *sTable, -INF, INF, 0, hashMove);
+    _MY_ASSERT(hashMove == MOVE, "A fail-low dropped the stored move");
+
+    tt.clear(2);
+    _MY_ASSERT(!isStored(0) && !isStored(3), "Clearing left entries behind");
+
+    delete sTable;
+    tt.deinit();
+    print_completion("transposition_table");
+}
+
 } // namespace test
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "defs.hpp"
+#include <algorithm>
 #include <sstream>
 
 namespace test
@@ -8,5 +9,11 @@ namespace test
 
 void parseFen();
 void polyKeyGeneration();
+void perft();
+void legalMoveCheck();
+void staticExchange();
+void attackMaps();
+void sliderAttacks();
+void transpositionTable();
 
 } // namespace test
@@ -13,7 +13,7 @@ static int startWorkerThread(void* workerData)
     if (data->sInfo->debugMode)
 		std::cout << "Thread " << data->threadID << " finished working...\n";
     if (data->threadID == 0)
-        std::cout << "bestmove " << moveToStr(data->sTable->pvTable[0][0]) << "\n";
+        std::cout << "bestmove " << packedMoveToStr(data->sTable->pvTable[0][0]) << "\n";
     delete workerData;
 
     return 0;
@@ -1,5 +1,11 @@
 #include "defs.hpp"
 
+#include <algorithm>
+#include <cstdlib>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
 // clang-format off
 /*
 SMP Data - bit structure
@@ -8,69 +14,163 @@ SMP Data - bit structure
 0000000000000000000000000000000000000000000000011111111111111111   (score + INF)  17 bits        0
 0000000000000000000000000000000000000000011111100000000000000000      depth        6 bits        17
 0000000000000000000000000000000000000001100000000000000000000000      flag         2 bits        23
+0000000000000000000000000000000001111110000000000000000000000000      age          6 bits        25
+0000000000000000011111111111111110000000000000000000000000000000   packed move    16 bits        31
 
 */
 // clang-format on
 
 const int SMP_INF = INF + 1000;
+#define TT_AGE_MASK 0x3F
 #define EXTRACT_SCORE(x) ((x & 0x1FFFF) - SMP_INF)
 #define EXTRACT_DEPTH(x) ((x >> 17) & 0x3F)
 #define EXTRACT_FLAG(x) ((x >> 23) & 0x3)
+#define EXTRACT_AGE(x) ((x >> 25) & TT_AGE_MASK)
+#define EXTRACT_MOVE(x) ((uint16_t)(x >> 31))
 
-#define FOLD_DATA(score, de, flag) ((score + SMP_INF) | (de << 17) | (flag << 23))
+#define FOLD_DATA(score, de, flag, age, move)                                                     \
+    ((score + SMP_INF) | (de << 17) | (flag << 23) | ((uint64_t)(age & TT_AGE_MASK) << 25) |      \
+     ((uint64_t)(move) << 31))
 
 TT::TT()
     //: key(0ULL), lock(0ULL), depth(0), flag(F_EXACT), score(0), age(0), smpKey(0ULL),
     //: smpData(0ULL)
-    : age(0), smpKey(0ULL), smpData(0ULL)
+    : smpKey(0ULL), smpData(0ULL)
 {
 }
 
-static const int ONE_MB = 0x100000;
+static const uint64_t ONE_MB = 0x100000;
+// Size of a huge page on x86-64, a table aligned to it can be fully backed by huge pages
+static const size_t TT_ALIGNMENT = 2 * ONE_MB;
 
 const int NO_TT_ENTRY = 100'000;
 
 HashTable hashTable;
 
-HashTable::HashTable() : table(nullptr), entryCount(0), currentAge(0), newWrite(0), overWrite(0) {}
+// Zeroed memory straight from the OS, whose pages are only backed once they're touched
+static void* allocZeroed(const size_t size)
+{
+#if defined(__linux__)
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return memory == MAP_FAILED ? nullptr : memory;
+#elif defined(_WIN32)
+    return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    return calloc(1, size);
+#endif
+}
+
+static void freeZeroed(void* memory, const size_t size)
+{
+#if defined(__linux__)
+    munmap(memory, size);
+#elif defined(_WIN32)
+    (void)size;
+    VirtualFree(memory, 0, MEM_RELEASE);
+#else
+    (void)size;
+    free(memory);
+#endif
+}
 
-void HashTable::init(int MB)
+HashTable::HashTable()
+    : memory(nullptr), memorySize(0), table(nullptr), bucketCount(0), entryCount(0), currentAge(0),
+      newWrite(0), overWrite(0)
+{
+}
+
+void HashTable::init(uint64_t MB)
 {
     _MY_ASSERT(MB >= 1, "Minimum size of transposition table is 1 MB");
-    _MY_ASSERT(MB <= 1024, "Maximum size of transposition table is 1024 MB");
+    // Sizes are in bytes from here on, which has to fit the address space. A larger request is
+    // clamped, if even that can't be allocated the halving below takes over
+    const uint64_t MAX_MB = std::min<uint64_t>(MAX_TT_SIZE, (SIZE_MAX - TT_ALIGNMENT) / ONE_MB);
+    if (MB > MAX_MB) {
+        std::cout << "[ INFO]: Clamping the hash size from " << MB << "MB to " << MAX_MB << "MB\n";
+        MB = MAX_MB;
+    }
 
-    const int HASH_SIZE = ONE_MB * MB;
-    entryCount = HASH_SIZE / sizeof(TT);
-    //entryCount = 1'000'000;
+    const uint64_t HASH_SIZE = ONE_MB * MB;
+    bucketCount = HASH_SIZE / sizeof(TTBucket);
+    entryCount = bucketCount * TT_BUCKET_SIZE;
 
     if (table != nullptr) {
         std::cout << "Clearing memory!\n";
         deinit();
     }
 
-    table = new TT[entryCount];
-    if (table == nullptr) {
-        int reducedSize = HASH_SIZE / 2;
-        std::cout << "[ERROR]: Couldn't allocate " << HASH_SIZE << "MB\n";
-        std::cout << "[ INFO]: Trying to allocate " << reducedSize << "MB\n";
-        init(reducedSize);
+    // Zeroed memory is an empty table, so there's nothing to clear here. The OS hands out zeroed
+    // pages lazily, which keeps the default 256 MB from costing anything at startup. The spare
+    // huge page lets the table start on a 2 MB boundary.
+    const size_t TABLE_SIZE = (size_t)bucketCount * sizeof(TTBucket);
+    memorySize = TABLE_SIZE + TT_ALIGNMENT;
+    memory = allocZeroed(memorySize);
+    if (memory == nullptr) {
+        _MY_ASSERT(MB > 1, "Couldn't allocate the transposition table");
+        std::cout << "[ERROR]: Couldn't allocate " << MB << "MB\n";
+        std::cout << "[ INFO]: Trying to allocate " << MB / 2 << "MB\n";
+        init(MB / 2);
+        return;
     }
+    const uintptr_t ALIGN_MASK = TT_ALIGNMENT - 1;
+    table = (TTBucket*)(((uintptr_t)memory + ALIGN_MASK) & ~ALIGN_MASK);
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    // Transparent huge pages let one TLB entry cover 2 MB of the table instead of 4 KB, without
+    // them nearly every probe of a large table misses the TLB
+    madvise(table, TABLE_SIZE, MADV_HUGEPAGE);
+#endif
 
-    clear();
+    currentAge = 0;
+    newWrite = 0;
+    overWrite = 0;
     //std::cout << "Transposition table initialized with size of " << MB << " MB(" << entryCount << " entries)\n";
 }
 
 void HashTable::deinit()
 {
 	//std::cout << "Deinitialized the transposition table!\n";
-    delete[] table;
+    freeZeroed(memory, memorySize);
+    memory = nullptr;
+    table = nullptr;
 }
 
-void HashTable::clear()
+struct ClearJob
 {
-    for (int i = 0; i < entryCount; i++) {
-        table[i] = TT();
+    char* start;
+    size_t size;
+};
+
+static int clearWorker(void* arg)
+{
+    ClearJob* job = (ClearJob*)arg;
+    memset(job->start, 0, job->size);
+    return 0;
+}
+
+// Zeroes the table on up to 'threadCount' threads, each one takes a slice of whole huge pages
+void HashTable::clear(const int threadCount)
+{
+    const size_t TABLE_SIZE = (size_t)bucketCount * sizeof(TTBucket);
+    int count = threadCount < 1 ? 1 : threadCount;
+    if (count > MAX_THREADS)
+        count = MAX_THREADS;
+    size_t sliceSize = (TABLE_SIZE / count + TT_ALIGNMENT - 1) & ~(TT_ALIGNMENT - 1);
+
+    thrd_t threads[MAX_THREADS];
+    ClearJob jobs[MAX_THREADS];
+    int started = 0;
+    for (size_t offset = 0; offset < TABLE_SIZE; offset += sliceSize, started++) {
+        jobs[started] = {(char*)table + offset,
+                         TABLE_SIZE - offset < sliceSize ? TABLE_SIZE - offset : sliceSize};
+        // The calling thread clears the first slice itself
+        if (started > 0)
+            thrd_create(&threads[started], clearWorker, &jobs[started]);
     }
+    if (started > 0)
+        clearWorker(&jobs[0]);
+    for (int i = 1; i < started; i++)
+        thrd_join(threads[i], nullptr);
+
     currentAge = 0;
     newWrite = 0;
     overWrite = 0;
@@ -98,20 +198,26 @@ void verifyEntrySMP(TT entry)
 }
 #endif
 
-// read hash entry data
-int HashTable::read(Board& board, const SearchTable& sTable, int alpha, int beta, int depth)
+// read hash entry data, 'hashMove' is set to the stored best move even when the score can't be used
+int HashTable::read(Board& board, const SearchTable& sTable, int alpha, int beta, int depth,
+                    int& hashMove)
 {
-    TT entry = table[board.key % entryCount];
-
-    uint64_t testKey = board.key ^ entry.smpData;
+    hashMove = 0;
+    const TTBucket& bucket = *bucketOf(board.key);
+    for (const TT& entry : bucket.entries) {
+        // Copy the entry once, another thread may be writing to it
+        uint64_t smpData = entry.smpData;
+
+        // make sure we're dealing with the exact position we need
+        if (entry.smpKey != (board.key ^ smpData))
+            continue;
 
-    // make sure we're dealing with the exact position we need
-    // if (entry.key == board.key && entry.lock == board.lock) {
-    if (entry.smpKey == testKey) {
+        // The key check covers the move too, so it's never from another position
+        hashMove = unpackMove(EXTRACT_MOVE(smpData), board);
 
-        int smpDepth = EXTRACT_DEPTH(entry.smpData);
-        int smpFlag = EXTRACT_FLAG(entry.smpData);
-        int smpScore = EXTRACT_SCORE(entry.smpData);
+        int smpDepth = EXTRACT_DEPTH(smpData);
+        int smpFlag = EXTRACT_FLAG(smpData);
+        int smpScore = EXTRACT_SCORE(smpData);
 
         // make sure that we match the exact depth our search is now at
         if (smpDepth >= depth) {
@@ -140,31 +246,56 @@ int HashTable::read(Board& board, const SearchTable& sTable, int alpha, int beta
                 // return beta (fail-high node) score
                 return beta;
         }
+        // A position is stored at most once per bucket
+        break;
     }
 
     // if hash entry doesn't exist
     return NO_TT_ENTRY;
 }
 
-// write hash entry data
-void HashTable::store(Board& board, const SearchTable& sTable, int score, int depth, TTFlag flag)
+// How much an entry is worth keeping: deep entries from the current search first
+static int entryValue(const uint64_t smpData, const int currentAge)
 {
-    TT* entry = &table[board.key % entryCount];
+    int ageDistance = (currentAge - (int)EXTRACT_AGE(smpData)) & TT_AGE_MASK;
+    return (int)EXTRACT_DEPTH(smpData) - 8 * ageDistance;
+}
 
-    bool shouldReplace = false;
-    if (entry->smpKey == 0) {
-        // If the current entry has nothing written on it, place the new entry here
-        newWrite++;
-        shouldReplace = true;
-    } else {
-        overWrite++;
-        if (entry->age < currentAge || EXTRACT_DEPTH(entry->smpData) <= depth) {
-            shouldReplace = true;
+// write hash entry data, 'move' is the best move found or 0 if none raised alpha
+void HashTable::store(Board& board, const SearchTable& sTable, int score, int depth, TTFlag flag,
+                      const int move)
+{
+    TTBucket& bucket = *bucketOf(board.key);
+
+    // The entry of the same position if there is one, else an empty one, else the least valuable
+    TT* entry = &bucket.entries[0];
+    uint16_t packed = move ? packMove(move) : 0;
+    for (TT& candidate : bucket.entries) {
+        uint64_t smpData = candidate.smpData;
+        if (candidate.smpKey == (board.key ^ smpData)) {
+            // Keep a deeper bound of this search unless the new score is exact
+            if (flag != F_EXACT && (int)EXTRACT_DEPTH(smpData) > depth &&
+                (int)EXTRACT_AGE(smpData) == (currentAge & TT_AGE_MASK))
+                return;
+            // A fail-low has no best move, the one found before is still the best guess
+            if (packed == 0)
+                packed = EXTRACT_MOVE(smpData);
+            entry = &candidate;
+            break;
+        }
+        if (smpData == 0ULL) {
+            entry = &candidate;
+            break;
         }
+        if (entryValue(smpData, currentAge) < entryValue(entry->smpData, currentAge))
+            entry = &candidate;
     }
 
-    if (!shouldReplace)
-        return;
+    // Written entries are never 0, the score is stored with an offset
+    if (entry->smpData == 0ULL)
+        newWrite++;
+    else
+        overWrite++;
 
     // store score independent from the actual path
     // from root node (position) to current node (position)
@@ -173,16 +304,8 @@ void HashTable::store(Board& board, const SearchTable& sTable, int score, int de
     if (score > MATE_SCORE)
         score += sTable.ply;
 
-    uint64_t smpData = FOLD_DATA(score, depth, flag);
+    uint64_t smpData = FOLD_DATA(score, depth, flag, currentAge, packed);
     // write hash entry data
-#if 0
-    entry->key = board.key;
-    entry->lock = board.lock;
-    entry->score = score;
-    entry->flag = flag;
-    entry->depth = depth;
-#endif
-    entry->age = currentAge;
     entry->smpData = smpData;
     entry->smpKey = smpData ^ board.key;
 }
@@ -193,19 +316,21 @@ void dataCheck(const int move)
     int flag = rand() % 3;
     int score = rand() % INF;
 
-    uint64_t data = FOLD_DATA(score, depth, flag);
+    uint64_t data = FOLD_DATA(score, depth, flag, 0, packMove(move));
 
     int extDepth = EXTRACT_DEPTH(data);
     int extScore = EXTRACT_SCORE(data);
     int extFlag = EXTRACT_FLAG(data);
+    uint16_t extMove = EXTRACT_MOVE(data);
 
     _MY_ASSERT(depth == extDepth, "depth != SMP_DEPTH");
     _MY_ASSERT(score == extScore, "score != SMP_SCORE");
     _MY_ASSERT(flag == extFlag, "flag != SMP_FLAG");
+    _MY_ASSERT(packMove(move) == extMove, "move != SMP_MOVE");
 #if 0
     std::cout << " Orig: move:" << moveToStr(move) << " score: " << score << " depth: " << depth
               << " flag: " << flag << "\n";
-    std::cout << "Check: move:" << moveToStr(extDepth) << " score: " << extScore
+    std::cout << "Check: move:" << packedMoveToStr(extMove) << " score: " << extScore
               << " depth: " << extDepth << " flag: " << extFlag << "\n\n";
 #endif
 }
@@ -219,16 +344,12 @@ void tempHashTest(const std::string fen)
 
     MoveList moveList;
     genAllMoves(moveList, board);
-    Board clone;
+    Undo undo;
     for (int i = 0; i < moveList.count; i++) {
-        // Clone the current state of the board
-        clone = board;
-        // Make move if it's not illegal (or check)
-        if (!makeMove(&board, moveList.list[i], AllMoves))
-            continue;
+        makeMove(&board, moveList.list[i], AllMoves, undo);
 
         // Restore board state
-        board = clone;
+        unmakeMove(&board, moveList.list[i], undo);
 
         dataCheck(moveList.list[i]);
     }
@@ -5,6 +5,20 @@
 
 SearchInfo sInfo;
 static Board board;
+// Set by a Hash change, whose fresh table is paged in by the next isready
+static bool hashNeedsClear = false;
+
+// Zeroes the table on all search threads, which also pages in a freshly allocated one so that
+// the first search doesn't take its page faults one at a time
+static void clearHash()
+{
+    long long start = getCurrTime();
+    hashTable.clear(sInfo.threadCount);
+    hashNeedsClear = false;
+    if (sInfo.debugMode)
+        std::cout << "info string Cleared the hash on " << sInfo.threadCount << " threads in "
+                  << getCurrTime() - start << " ms\n";
+}
 
 void uciLoop()
 {
@@ -29,7 +43,7 @@ void parse(const std::string& command)
     } else if (command == "stop") {
         joinSearchThread(&sInfo);
     } else if (command == "ucinewgame") {
-        hashTable.clear();
+        clearHash();
         parsePos("position startpos");
     } else if (command == "uci") {
         printEngineID();
@@ -38,9 +52,11 @@ void parse(const std::string& command)
     } else if (command == "run") {
         parse("position fen 8/k7/3p4/p2P1p2/P2P1P2/8/8/K7 w - - 0 1");
         parse("go infinite");
-    } else if (command == "isready")
+    } else if (command == "isready") {
+        if (hashNeedsClear)
+            clearHash();
         std::cout << "readyok\n";
-    else if (command.compare(0, 8, "position") == 0)
+    } else if (command.compare(0, 8, "position") == 0)
         parsePos(command);
     else if (command.compare(0, 2, "go") == 0)
         parseGo(command);
@@ -53,7 +69,7 @@ void parse(const std::string& command)
                   << hashTable.entryCount
                   << "\n";
         std::cout << "TT  % Filled: "
-                  << ((float)hashTable.newWrite / hashTable.entryCount) * 100.f << "% \n";
+                  << ((double)hashTable.newWrite / hashTable.entryCount) * 100.0 << "% \n";
     } else if (command == "eval") {
         int eval = evaluatePos(board);
         std::cout << "Current eval: " << eval << "\n";
@@ -75,6 +91,12 @@ void parse(const std::string& command)
     } else if (command.compare(0, 5, "perft") == 0) {
         int depth = atoi(command.substr(6).c_str());
         perftTest(board, depth, AllMoves);
+    } else if (command == "bench fills") {
+        runFillBench();
+    } else if (command == "bench threads") {
+        runThreadBench();
+    } else if (command.compare(0, 5, "bench") == 0) {
+        runBench(command.length() > 6 ? atoi(command.substr(6).c_str()) : 7);
     } else if (command == "help")
         printHelpInfo();
     else
@@ -87,8 +109,9 @@ void parsePos(const std::string& command)
         return;
     // Shift pointer to the beginning of args
     int currentInd = 9;
-    // Reset board before setting piece up
+    // Reset board and game history before setting piece up
     board = Board();
+    mainSearchTable.repetitionIndex = 0;
     if (command.compare(currentInd, 8, "startpos") == 0) {
         currentInd += 8 + 1; // (+ 1) for the space
         board.parseFen(FEN_POSITIONS[1]);
@@ -102,6 +125,7 @@ void parsePos(const std::string& command)
     currentInd += 6;
     std::string moveStr;
     int move;
+    Undo undo;
     for (int i = currentInd; i <= command.length(); i++) {
         if (std::isdigit(command[i]) || std::isalpha(command[i]))
             moveStr += command[i];
@@ -111,10 +135,10 @@ void parsePos(const std::string& command)
                 continue;
 
             // Update repetition table
-            board.repetitionIndex++;
-            board.repetitionTable[board.repetitionIndex] = board.key;
+            mainSearchTable.repetitionIndex++;
+            mainSearchTable.repetitionTable[mainSearchTable.repetitionIndex] = board.key;
 
-            makeMove(&board, move, MoveType::AllMoves);
+            makeMove(&board, move, MoveType::AllMoves, undo);
             moveStr = "";
         }
     }
@@ -221,8 +245,9 @@ void parseSetOption(const std::string& command)
     }
 
     if (name == "Hash") {
-        int hashSizeVal = std::stoi(value);
+        uint64_t hashSizeVal = std::stoull(value);
         hashTable.init(hashSizeVal);
+        hashNeedsClear = true;
     } else if (name == "Book") {
         sInfo.useBook = (value == "true");
     }
@@ -243,7 +268,8 @@ void printEngineID()
 
 void printEngineOptions()
 {
-    std::cout << "option name Hash type spin default 128 min 1 max 1024\n";
+    std::cout << "option name Hash type spin default " << DEFAULT_TT_SIZE << " min 1 max "
+              << MAX_TT_SIZE << "\n";
     std::cout << "option name Book type check default " << (sInfo.useBook ? "true" : "false") << "\n";
 }
 
@@ -278,4 +304,10 @@ void printHelpInfo()
               << "number of moves from a position for a given depth\n";
     std::cout << "                eval                       |    Returns the evaluation (in "
                  "centipawns) of the current position\n";
+    std::cout << "        bench <depth>                      |    Measures perft and search "
+              << "speed (default depth 7) with every sliding attack backend\n";
+    std::cout << "         bench fills                       |    Times sliding attack maps from "
+              << "magic lookups against Kogge-Stone fills\n";
+    std::cout << "       bench threads                       |    Measures perft speed on 1, 8 "
+              << "and 32 threads with every sliding attack backend\n";
 }
\ No newline at end of file
@@ -1,41 +1,62 @@
 #include "defs.hpp"
 
-uint64_t pieceKeys[12][64];
-uint64_t enpassKeys[8];
-uint64_t castlingKeys[16];
-uint64_t sideKey;
+struct ZobristKeys
+{
+    uint64_t pieceKeys[12][64] = {};
+    uint64_t enpassKeys[8] = {};
+    uint64_t castlingKeys[16] = {};
+    uint64_t sideKey = 0ULL;
 
-uint64_t pieceLocks[12][64];
-uint64_t enpassLocks[8];
-uint64_t castlingLocks[16];
-uint64_t sideLock;
+    uint64_t pieceLocks[12][64] = {};
+    uint64_t enpassLocks[8] = {};
+    uint64_t castlingLocks[16] = {};
+    uint64_t sideLock = 0ULL;
+};
 
-void initZobrist()
+// The keys are drawn in the same order as they used to be at startup, so they haven't changed
+static constexpr ZobristKeys genZobristKeys()
 {
+    ZobristKeys z;
+    XorShift rng;
+
     // Init piece keys and locks
     for (int piece = wP; piece <= bK; piece++) {
         for (int sq = 0; sq <= 63; sq++) {
-            pieceKeys[piece][sq] = random64();
-            pieceLocks[piece][sq] = random64();
+            z.pieceKeys[piece][sq] = rng.random64();
+            z.pieceLocks[piece][sq] = rng.random64();
         }
     }
 
     // Init enpassant files keys and locks
     for (int f = 0; f < 8; f++) {
-        enpassKeys[f] = random64();
-        enpassLocks[f] = random64();
+        z.enpassKeys[f] = rng.random64();
+        z.enpassLocks[f] = rng.random64();
     }
 
     // Init keys for the different castling rights variations
     for (int i = 0; i < 16; i++) {
-        castlingKeys[i] = random64();
-        castlingLocks[i] = random64();
+        z.castlingKeys[i] = rng.random64();
+        z.castlingLocks[i] = rng.random64();
     }
 
-    sideKey = random64();
-    sideLock = random64();
+    z.sideKey = rng.random64();
+    z.sideLock = rng.random64();
+    return z;
 }
 
+// Takes more steps than MSVC allows by default, the project files raise /constexpr:steps
+static constexpr ZobristKeys ZOBRIST = genZobristKeys();
+
+static constexpr auto& pieceKeys = ZOBRIST.pieceKeys;
+static constexpr auto& enpassKeys = ZOBRIST.enpassKeys;
+static constexpr auto& castlingKeys = ZOBRIST.castlingKeys;
+static constexpr auto& sideKey = ZOBRIST.sideKey;
+
+static constexpr auto& pieceLocks = ZOBRIST.pieceLocks;
+static constexpr auto& enpassLocks = ZOBRIST.enpassLocks;
+static constexpr auto& castlingLocks = ZOBRIST.castlingLocks;
+static constexpr auto& sideLock = ZOBRIST.sideLock;
+
 void updateZobristCastling(Board& board)
 {
     board.key ^= castlingKeys[board.castling];
@@ -70,9 +91,8 @@ uint64_t genKey(const Board& board)
     for (int piece = wP; piece <= bK; piece++) {
         bitboardCopy = board.pieces[piece];
         while (bitboardCopy) {
-            sq = lsbIndex(bitboardCopy);
+            sq = popLsb(bitboardCopy);
             output ^= pieceKeys[piece][sq];
-            popBit(bitboardCopy, sq);
         }
     }
     // Hash enpassant square
@@ -96,9 +116,8 @@ uint64_t genLock(const Board& board)
     for (int piece = wP; piece <= bK; piece++) {
         bitboardCopy = board.pieces[piece];
         while (bitboardCopy) {
-            sq = lsbIndex(bitboardCopy);
+            sq = popLsb(bitboardCopy);
             output ^= pieceLocks[piece][sq];
-            popBit(bitboardCopy, sq);
         }
     }
     // Hash enpassant square
@@ -0,0 +1,232 @@
+/*
+        Magic number generator
+        Searches the bishop and rook magics of all 64 squares on several threads and writes them
+        as a header that src/magics.cpp includes. Every square gets its own random number
+        generator, seeded from the square and the base seed, so the output only depends on the
+        options and never on the number of threads or how the squares were shared between them.
+
+        With a dense search budget, a square keeps looking for magics that index its attacks
+        with fewer bits than it has relevant squares (constructive collisions), which shrinks its
+        part of the attack table by half for every bit saved.
+
+        Usage: magicgen [-t threads] [-s seed] [-d dense attempts] [-o output header]
+*/
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "../src/defs.hpp"
+
+struct SquareJob
+{
+    PieceTypes piece;
+    int sq;
+    uint64_t magic;
+    int bits; // Index bits of the magic, at most the number of relevant squares
+};
+
+static SquareJob jobs[128]; // Bishops on 0-63, rooks on 64-127
+static std::atomic<int> nextJob(0);
+static uint32_t baseSeed = 1804289383;
+static long long denseAttempts = 0;
+
+// Squares whose occupancy changes a slider's attacks, board edges excluded
+static uint64_t relevantMask(const PieceTypes piece, const int sq)
+{
+    const int dirs[2][4][2] = {{{1, 1}, {1, -1}, {-1, 1}, {-1, -1}},
+                               {{1, 0}, {-1, 0}, {0, 1}, {0, -1}}};
+    uint64_t output = 0ULL;
+    for (const auto& d : dirs[piece == ROOK]) {
+        for (int r = ROW(sq) + d[0], f = COL(sq) + d[1];; r += d[0], f += d[1]) {
+            // Stop before the last square of the ray
+            int nr = r + d[0], nf = f + d[1];
+            if (r < 0 || r > 7 || f < 0 || f > 7 || nr < 0 || nr > 7 || nf < 0 || nf > 7)
+                break;
+            setBit(output, SQ(r, f));
+        }
+    }
+    return output;
+}
+
+static uint64_t sliderAttack(const PieceTypes piece, const int sq, const uint64_t blockers)
+{
+    const int dirs[2][4][2] = {{{1, 1}, {1, -1}, {-1, 1}, {-1, -1}},
+                               {{1, 0}, {-1, 0}, {0, 1}, {0, -1}}};
+    uint64_t output = 0ULL;
+    for (const auto& d : dirs[piece == ROOK]) {
+        for (int r = ROW(sq) + d[0], f = COL(sq) + d[1]; r >= 0 && r <= 7 && f >= 0 && f <= 7;
+             r += d[0], f += d[1]) {
+            setBit(output, SQ(r, f));
+            if (getBit(blockers, SQ(r, f)))
+                break;
+        }
+    }
+    return output;
+}
+
+// Tries 'attempts' random sparse numbers, returns the first one that maps every occupancy to an
+// index with the right attacks (or no attacks yet), 0 if none did
+static uint64_t findMagic(XorShift& rng, const uint64_t mask, const uint64_t* occupancies,
+                          const uint64_t* attacks, const int count, const int bits,
+                          const long long attempts)
+{
+    // An entry only counts as used if it was written for the current candidate, which saves
+    // clearing the table for every candidate
+    static thread_local uint64_t used[4096];
+    static thread_local uint32_t usedBy[4096];
+    static thread_local uint32_t candidate = 0;
+
+    for (long long i = 0; i < attempts; i++) {
+        uint64_t magic = rng.random64() & rng.random64() & rng.random64();
+        if (countBits((mask * magic) & 0xFF00000000000000ULL) < 6)
+            continue;
+
+        candidate++;
+        bool failed = false;
+        for (int j = 0; j < count && !failed; j++) {
+            int index = (int)((occupancies[j] * magic) >> (64 - bits));
+            if (usedBy[index] != candidate) {
+                usedBy[index] = candidate;
+                used[index] = attacks[j];
+            } else if (used[index] != attacks[j])
+                failed = true;
+        }
+        if (!failed)
+            return magic;
+    }
+    return 0ULL;
+}
+
+static void searchSquare(SquareJob& job)
+{
+    uint64_t occupancies[4096], attacks[4096];
+    uint64_t mask = relevantMask(job.piece, job.sq);
+    int count = 0;
+    // Every subset of the mask (Carry-Rippler)
+    uint64_t occupancy = 0ULL;
+    do {
+        occupancies[count] = occupancy;
+        attacks[count++] = sliderAttack(job.piece, job.sq, occupancy);
+        occupancy = (occupancy - mask) & mask;
+    } while (occupancy);
+
+    // The seed only depends on the square, xorshift's state must never be 0
+    uint32_t jobIndex = (job.piece == ROOK ? 64 : 0) + job.sq;
+    XorShift rng{baseSeed ^ (jobIndex + 1) * 0x9E3779B9u};
+    if (rng.state == 0)
+        rng.state = 1;
+
+    job.bits = countBits(mask);
+    job.magic = findMagic(rng, mask, occupancies, attacks, count, job.bits, 100'000'000);
+    if (job.magic == 0ULL) {
+        std::printf("[ERROR]: No magic found for the %s on square %d\n",
+                    job.piece == BISHOP ? "bishop" : "rook", job.sq);
+        std::exit(1);
+    }
+
+    // Keep removing bits for as long as a magic turns up within the budget
+    while (denseAttempts > 0 && job.bits > 1) {
+        uint64_t magic = findMagic(rng, mask, occupancies, attacks, count, job.bits - 1,
+                                   denseAttempts);
+        if (magic == 0ULL)
+            break;
+        job.magic = magic;
+        job.bits--;
+    }
+}
+
+static int searchWorker(void* arg)
+{
+    (void)arg;
+    for (int i = nextJob++; i < 128; i = nextJob++)
+        searchSquare(jobs[i]);
+    return 0;
+}
+
+static void writeArray(FILE* file, const char* type, const char* name, const int first,
+                       const bool magics)
+{
+    const int perRow = magics ? 4 : 8;
+    std::fprintf(file, "const %s %s[64] = {\n", type, name);
+    for (int sq = 0; sq < 64; sq++) {
+        const SquareJob& job = jobs[first + sq];
+        if (sq % perRow == 0)
+            std::fprintf(file, "   ");
+        if (magics)
+            std::fprintf(file, " 0x%016llxULL,", (unsigned long long)job.magic);
+        else
+            std::fprintf(file, " %2d,", job.bits);
+        if (sq % perRow == perRow - 1)
+            std::fprintf(file, "\n");
+    }
+    std::fprintf(file, "};\n");
+}
+
+static void writeHeader(const char* path)
+{
+    FILE* file = std::fopen(path, "w");
+    if (file == nullptr) {
+        std::printf("[ERROR]: Couldn't open %s\n", path);
+        std::exit(1);
+    }
+    int bishopEntries = 0, rookEntries = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        bishopEntries += 1 << jobs[sq].bits;
+        rookEntries += 1 << jobs[64 + sq].bits;
+    }
+
+    std::fprintf(file, "#pragma once\n\n");
+    std::fprintf(file, "// Generated by tools/magicgen (seed %u, dense attempts %lld), don't edit\n",
+                 baseSeed, denseAttempts);
+    std::fprintf(file, "// Magic lookups use %d bishop and %d rook attack entries\n\n",
+                 bishopEntries, rookEntries);
+    std::fprintf(file, "#include <cstdint>\n\n// clang-format off\n");
+    writeArray(file, "uint64_t", "BISHOP_MAGICS", 0, true);
+    std::fprintf(file, "\n// Index bits of each bishop magic\n");
+    writeArray(file, "int", "BISHOP_MAGIC_BITS", 0, false);
+    std::fprintf(file, "\n");
+    writeArray(file, "uint64_t", "ROOK_MAGICS", 64, true);
+    std::fprintf(file, "\n// Index bits of each rook magic\n");
+    writeArray(file, "int", "ROOK_MAGIC_BITS", 64, false);
+    std::fprintf(file, "// clang-format on\n");
+    std::fclose(file);
+
+    std::printf("Wrote %s: %d bishop and %d rook entries\n", path, bishopEntries, rookEntries);
+}
+
+int main(int argc, char* argv[])
+{
+    int threadCount = (int)std::thread::hardware_concurrency();
+    const char* output = "src/magic_consts.hpp";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "-t"))
+            threadCount = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "-s"))
+            baseSeed = (uint32_t)std::strtoul(argv[i + 1], nullptr, 10);
+        else if (!std::strcmp(argv[i], "-d"))
+            denseAttempts = std::atoll(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "-o"))
+            output = argv[i + 1];
+    }
+    if (threadCount < 1)
+        threadCount = 1;
+
+    for (int i = 0; i < 128; i++)
+        jobs[i] = {i < 64 ? BISHOP : ROOK, i % 64, 0ULL, 0};
+
+    auto start = std::chrono::steady_clock::now();
+    thrd_t* threads = new thrd_t[threadCount];
+    for (int i = 0; i < threadCount; i++)
+        thrd_create(&threads[i], searchWorker, nullptr);
+    for (int i = 0; i < threadCount; i++)
+        thrd_join(threads[i], nullptr);
+    delete[] threads;
+    auto time = std::chrono::steady_clock::now() - start;
+
+    std::printf("Searched 128 squares on %d threads in %lld ms\n", threadCount,
+                (long long)std::chrono::duration_cast<std::chrono::milliseconds>(time).count());
+    writeHeader(output);
+}